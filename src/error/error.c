@@ -1,24 +1,122 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../logger/logger.h"
+#include "../memory/allocator.h"
+#include "../memory/pool.h"
 #include "error.h"
 
+Pool errorPool = POOL_INIT("Error", Error);
+
 ErrorContext *errorContext = NULL;
 
+// Formats of the messages, indexed by ErrorCode. Each takes the error's arguments in order.
+static const char *ErrorFormats[] = {
+    "%s",
+    // Parser
+    "Expected token %s, instead got %s.",
+    "Expected a closing parentheses.",
+    "Expecting either a terminal or a starting parentheses, instead got token %s.",
+    "Expecting a function call.",
+    "Expected function call to end with right parentheses.",
+    "Invalid function parameter definition, should be \"arg\" or \"arg = value\", where value is a string, number or null.",
+    "Function definition should start with \"function\" and left parentheses: function(arg1, arg2, ...)",
+    "Function definition should end with right parentheses and a new line: function(arg1, arg2, ...)",
+    "Function block not terminated with \"end function\".",
+    "Function block not terminated with \"end function\"",
+    "Else block not terminated with \"end if\".",
+    "Else If block not terminated with \"end if\" or \"else\".",
+    "If block not terminated with \"end if\" or \"else\".",
+    "While loop not terminated with \"end while\".",
+    // Executor
+    "unary positive expects a number, instead got %s",
+    "unary negative expects a number, instead got %s",
+    "addition expects two strings or two numbers, instead got values of type %s and %s",
+    "subtraction expects two numbers or two strings, instead got values of type %s and %s",
+    "multiplication expects two numbers or a string and a number, instead got values of type %s and %s",
+    "division expects two numbers or a string and a number, instead got values of type %s and %s",
+    "modulo expects two numbers, instead got values of type %s and %s",
+    "power expects two numbers, instead got values of type %s and %s",
+    "greaterThan expects two numbers or two strings, instead got values of type %s and %s",
+    "greaterThanOrEqualTo expects two numbers or two strings, instead got values of type %s and %s",
+    "lessThan expects two numbers or two strings, instead got values of type %s and %s",
+    "lessThanOrEqualTo expects two numbers or two strings, instead got values of type %s and %s",
+    "Undeclared identifier \"%s\"",
+    "Too many arguments provided to function.",
+    "Too little arguments provided to function.",
+    "No such identifier %s",
+    "Identifier %s is not a function.",
+    "Function parameter has the same identifier name \"%s\"",
+};
+
 void criticalError(const char *msg)
 {
     log_message(&executionLogger, "Critical Error: %s", msg);
     exit(1);
 }
 
+ErrorContext *error_retainContext(ErrorContext *ctx)
+{
+    if (ctx != NULL)
+        ctx->refCount++;
+    return ctx;
+}
+
+// Contexts can outlive the region of their run, so they come from baseAllocator.
+void error_releaseContext(ErrorContext *ctx)
+{
+    if (ctx == NULL || --ctx->refCount > 0)
+        return;
+    baseAllocator->release(baseAllocator, ctx->lines.starts);
+    baseAllocator->release(baseAllocator, ctx);
+}
+
+void freeErrorContext()
+{
+    error_releaseContext(errorContext);
+    errorContext = NULL;
+}
+
+void _error_addLine(LineIndex *lines, size_t offset)
+{
+    if (lines->count == lines->capacity) {
+        lines->capacity = lines->capacity == 0 ? 64 : lines->capacity * 2;
+        lines->starts = baseAllocator->resize(baseAllocator, lines->starts, sizeof(size_t) * lines->capacity);
+    }
+    lines->starts[lines->count++] = offset;
+}
+
 void initErrorContext(const char *source)
 {
-    if (errorContext != NULL)
-        free(errorContext);
-    errorContext = malloc(sizeof(ErrorContext));
-    if (errorContext == NULL)
-        criticalError("initErrorContext: Could not allocate memory for error context.\n");
-    errorContext->source = source;
+    freeErrorContext();
+    size_t sourceLength = strlen(source);
+    errorContext = mem_allocBase(sizeof(ErrorContext) + sourceLength + 1);
+    errorContext->source = (char *) (errorContext + 1);
+    memcpy(errorContext->source, source, sourceLength + 1);
+    errorContext->sourceLength = sourceLength;
+    errorContext->lines = (LineIndex) {NULL, 0, 0, 0};
+    errorContext->refCount = 1;
+    _error_addLine(&errorContext->lines, 0);
+}
+
+void error_addLine(size_t offset)
+{
+    _error_addLine(&errorContext->lines, offset);
+}
+
+// Indexes the lines of `ctx` after the last one recorded, once.
+void _error_indexLines(ErrorContext *ctx)
+{
+    LineIndex *lines = &ctx->lines;
+    if (lines->complete)
+        return;
+    const char *source = ctx->source;
+    const char *end = source + ctx->sourceLength;
+    const char *nl = source + lines->starts[lines->count - 1];
+    while ((nl = memchr(nl, '\n', end - nl)) != NULL) {
+        nl++;
+        _error_addLine(lines, nl - source);
+    }
+    lines->complete = 1;
 }
 
 void _checkErrorContext()
@@ -30,15 +128,36 @@ void _checkErrorContext()
     criticalError("Error context not initialised.");
 }
 
-Error *error_new(ErrorType type, int lineNum, int colNum)
+Error *error_new(ErrorType type, ErrorCode code, int lineNum, int colNum)
 {
     _checkErrorContext();
-    Error *err = malloc(sizeof(Error));
+    Error *err = pool_alloc(&errorPool);
     err->type = type;
+    err->code = code;
     err->ctx = errorContext;
-    err->message[0] = '\0';
+    err->holdsCtx = 0;
     err->lineNum = lineNum;
     err->colNum = colNum;
+    err->args[0] = NULL;
+    err->args[1] = NULL;
+    err->text = NULL;
+    return err;
+}
+
+Error *error_withArgs(Error *err, const char *arg0, const char *arg1)
+{
+    err->args[0] = arg0;
+    err->args[1] = arg1;
+    return err;
+}
+
+Error *error_withText(Error *err, const char *text)
+{
+    size_t len = strlen(text);
+    mem_free(err->text);
+    err->text = mem_alloc(len + 1);
+    memcpy(err->text, text, len + 1);
+    err->args[0] = err->text;
     return err;
 }
 
@@ -61,9 +180,11 @@ void error_string(Error *error, char *dest, size_t destLen)
     dest[i+1] = ' ';
     i += 2;
 
-    // 2. Copy error message in
-    size_t msgSize = strnlen(error->message, MAX_ERRMSG_LEN);
-    strncpy(dest + i, error->message, msgSize);
+    // 2. Format the error message in
+    char message[MAX_ERRMSG_LEN];
+    snprintf(message, MAX_ERRMSG_LEN, ErrorFormats[error->code], error->args[0], error->args[1]);
+    size_t msgSize = strnlen(message, MAX_ERRMSG_LEN);
+    strncpy(dest + i, message, msgSize);
     i += msgSize;
 
     // 3. Add context
@@ -76,28 +197,14 @@ void error_string(Error *error, char *dest, size_t destLen)
     dest[i] = '\n';
     i++;
     
-    // 3.1. Identify the correct line
+    // 3.1. Identify the correct line, which ends at the next line's start, or at the end of the source
     const char *source = error->ctx->source;
-    size_t sourceLen = strlen(source);
+    LineIndex *lines = &error->ctx->lines;
+    _error_indexLines(error->ctx);
     size_t tgtIdxStart = 0; size_t tgtIdxEnd = 0;
-    size_t curLine = 0;
-    for (size_t j = 0; j < sourceLen; j++) {
-        char c = *(source + j);
-        if (curLine == error->lineNum) {
-            // At the desired line.
-            // Need to identify the size of the line
-            tgtIdxStart = j; tgtIdxEnd = j;
-            for (size_t k = j; k < sourceLen; k++) {
-                c = *(source + k);
-                if (c == '\n' || c == '\0')
-                    break;
-                tgtIdxEnd++;
-            }
-            break;
-        }
-
-        if (c == '\n')
-            curLine++;
+    if ((size_t) error->lineNum < lines->count) {
+        tgtIdxStart = lines->starts[error->lineNum];
+        tgtIdxEnd = (size_t) error->lineNum + 1 < lines->count ? lines->starts[error->lineNum + 1] - 1 : error->ctx->sourceLength;
     }
 
     // 3.2. Copy the entire line in
@@ -124,6 +231,8 @@ void error_string(Error *error, char *dest, size_t destLen)
 
 void error_free(Error *err)
 {
-    if (err)
-        free(err);
+    if (err->holdsCtx)
+        error_releaseContext(err->ctx);
+    mem_free(err->text);
+    pool_free(&errorPool, err);
 }
@@ -17,15 +17,42 @@
 // Denotes an error that is with the interpreter itself.
 void criticalError(const char *msg);
 
+// Offsets where the lines of the error context's source start, so that errors find their line without scanning the
+// source. The lexer records every line it reads, and the rest of the source is indexed the first time it's needed.
 typedef struct {
-    const char *source;
+    size_t *starts;   // starts[i] is the offset of line i
+    size_t count;
+    size_t capacity;
+    int complete;     // All lines of the source are indexed
+} LineIndex;
+
+// The source errors are shown in. Functions keep the context they were defined in, so that the errors of their body
+// are shown with its source after the run that defined them, see value_newFunction().
+typedef struct {
+    char *source;             // Copy of the source
+    size_t sourceLength;
+    LineIndex lines;
+    size_t refCount;
 } ErrorContext;
 
+// Context of the code being run
 extern ErrorContext* errorContext;
 
-// Initialises the error context for future errors
+// Initialises the error context for future errors, with a copy of `source`
 void initErrorContext(const char* source);
 
+// Drops the error context, if there's one.
+void freeErrorContext();
+
+// Adds a reference to `ctx`, which can be NULL. Returns `ctx`.
+ErrorContext* error_retainContext(ErrorContext* ctx);
+
+// Drops a reference to `ctx`, which can be NULL, and frees it with the last one.
+void error_releaseContext(ErrorContext* ctx);
+
+// Records that a line of the error context's source starts at `offset`, after the last one recorded.
+void error_addLine(size_t offset);
+
 typedef enum {
     ERR_TOKEN,
     ERR_SYNTAX,
@@ -33,6 +60,7 @@ typedef enum {
     ERR_RUNTIME,
     ERR_RUNTIME_TYPE,
     ERR_RUNTIME_NAME,
+    ERR_EMIT,
 } ErrorType;
 
 static const char *ErrorTypeString[] = {
@@ -41,19 +69,69 @@ static const char *ErrorTypeString[] = {
     "Syntax Error - Unexpected EOF",
     "Runtime Error",
     "Runtime Error - Type",
-    "Runtime Error - Undefined Identifier"
+    "Runtime Error - Undefined Identifier",
+    "Emit Error"
 };
 
+// Messages of errors. The text of a message is only formatted with its arguments by error_string(), so that an error
+// nobody reports costs no more than its struct.
+typedef enum {
+    MSG_TEXT,                 // The text of the error, see error_withText()
+    // Parser
+    MSG_EXPECTED_TOKEN,       // Expected and found token types
+    MSG_EXPECTED_PAREN_R,
+    MSG_EXPECTED_TERMINAL,    // Found token type
+    MSG_EXPECTED_CALL,
+    MSG_CALL_END,
+    MSG_PARAM_DEFINITION,
+    MSG_FN_START,
+    MSG_FN_END,
+    MSG_FN_BLOCK_END,
+    MSG_FN_BLOCK_EOF,
+    MSG_ELSE_BLOCK_END,
+    MSG_ELSEIF_BLOCK_END,
+    MSG_IF_BLOCK_END,
+    MSG_WHILE_BLOCK_END,
+    // Executor, the type arguments are value type names
+    MSG_POS_TYPE,             // Operand type
+    MSG_NEG_TYPE,             // Operand type
+    MSG_ADD_TYPES,            // Operand types
+    MSG_SUB_TYPES,            // Operand types
+    MSG_MUL_TYPES,            // Operand types
+    MSG_DIV_TYPES,            // Operand types
+    MSG_MOD_TYPES,            // Operand types
+    MSG_POW_TYPES,            // Operand types
+    MSG_GT_TYPES,             // Operand types
+    MSG_GEQ_TYPES,            // Operand types
+    MSG_LT_TYPES,             // Operand types
+    MSG_LEQ_TYPES,            // Operand types
+    MSG_UNDECLARED,           // Identifier name
+    MSG_TOO_MANY_ARGS,
+    MSG_TOO_FEW_ARGS,
+    MSG_NO_SUCH_IDENTIFIER,   // Identifier name
+    MSG_NOT_A_FUNCTION,       // Identifier name
+    MSG_DUPLICATE_PARAM,      // Identifier name
+} ErrorCode;
+
 typedef struct {
     ErrorType type;
-    ErrorContext* ctx;
-    char message[MAX_ERRMSG_LEN];
+    ErrorCode code;
+    ErrorContext* ctx;        // Source the position is in
+    int holdsCtx;             // 1 if the error holds a reference to ctx, see value_locate()
     int lineNum;
     int colNum;
+    const char *args[2];      // Arguments of the message, static strings or `text`
+    char *text;               // Owned argument, or NULL
 } Error;
 
 // New error -- set lineNum and colNum to -1 to avoid adding context
-Error* error_new(ErrorType type, int lineNum, int colNum);
+Error* error_new(ErrorType type, ErrorCode code, int lineNum, int colNum);
+
+// Sets the arguments of the message of `err`. They must outlive the error, like type names. Returns `err`.
+Error* error_withArgs(Error* err, const char* arg0, const char* arg1);
+
+// Sets the first argument of the message of `err` to a copy of `text`, like the name of an identifier. Returns `err`.
+Error* error_withText(Error* err, const char* text);
 
 // Outputs the error into the given string.
 void error_string(Error* error, char* dest, size_t destLen);
@@ -1,10 +1,55 @@
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include "../lexer/token.h"
+#include "../memory/allocator.h"
 #include "../parser/symbol.h"
 #include "../logger/logger.h"
 #include "executor.h"
 #include "symboltable.h"
+#include "memo.h"
+#include "numeric.h"
+#include "fusion.h"
+#include "hoist.h"
+#include "inliner.h"
+#include "typeinfer.h"
+#include "../stats/profile.h"
+#include "../stats/trace.h"
+
+size_t fnCalls = 0;
+
+#ifdef MS_PARANOID
+// Paranoid builds check that every evaluator only gets the kind of node execLower() linked it to.
+#define PARANOID_EXPECT(node, symType) paranoidExpect((node), (symType), (node)->numChildren, __func__)
+#define PARANOID_CHILDREN(node, count) paranoidExpect((node), (node)->type, (count), __func__)
+
+void paranoidExpect(ASTNode *node, SymbolType symType, size_t numChildren, const char *fnName)
+{
+    if (node->type == symType && node->numChildren == numChildren)
+        return;
+    char msg[MAX_ERRMSG_LEN];
+    snprintf(msg, MAX_ERRMSG_LEN, "%s: Invalid symbol %s with %lu children, expected %s with %lu children.",
+             fnName, SymbolTypeString[node->type], node->numChildren, SymbolTypeString[symType], numChildren);
+    criticalError(msg);
+}
+
+// And that every value has one of the types typeinfer_analyze() found for its node.
+#define PARANOID_TYPES(node, val) paranoidTypes((node), (val))
+
+void paranoidTypes(ASTNode *node, ExecValue *val)
+{
+    if (node->types == 0 || val->type == TYPE_ERROR || (node->types & TYPES_OF(val->type)))
+        return;
+    char msg[MAX_ERRMSG_LEN];
+    snprintf(msg, MAX_ERRMSG_LEN, "Value of type %s wasn't inferred for %s at line %d.",
+             ValueTypeString[val->type], SymbolTypeString[node->type], astnode_locator(node)->lineNum);
+    criticalError(msg);
+}
+#else
+#define PARANOID_EXPECT(node, symType)
+#define PARANOID_CHILDREN(node, count)
+#define PARANOID_TYPES(node, val)
+#endif
 
 // Returns the actual value of `val` if it's an identifier, otherwise just returns `val`.
 // If it's an identifier, `val` is freed.
@@ -20,9 +65,8 @@ ExecValue *unpackValue(Context *ctx, ExecValue *val)
         }
 
         if (newVal == NULL) {
-            Error *nameErr = error_new(ERR_RUNTIME_NAME, -1, -1);
-            snprintf(nameErr->message, MAX_ERRMSG_LEN, "Undeclared identifier \"%s\"", val->value.identifier_name);
-            ExecValue *errVal = value_newError(nameErr, val->tok);
+            Error *nameErr = error_new(ERR_RUNTIME_NAME, MSG_UNDECLARED, -1, -1);
+            ExecValue *errVal = value_newError(error_withText(nameErr, val->value.identifier_name));
             value_free(val);
             return errVal;
         }
@@ -32,74 +76,198 @@ ExecValue *unpackValue(Context *ctx, ExecValue *val)
     return val;
 }
 
-ExecValue *execTerminal(Context* ctx, ASTNode *terminal)
+// Gives the error `val` the position of `node`, if it doesn't have one yet, and returns it.
+ExecValue *locateError(ExecValue *val, ASTNode *node)
+{
+    return val->type == TYPE_ERROR ? value_locate(val, astnode_locator(node)) : val;
+}
+
+// Evaluates a lowered node and unpacks the result. Variables are looked up directly, without building an identifier first.
+ExecValue *execOperand(Context *ctx, ASTNode *node)
 {
-    if (terminal->type != SYM_TERMINAL)
-        criticalError("terminal: Invalid symbol type, expected SYM_TERMINAL");
+    if (node->eval != execIdentifier) {
+        ExecValue *val = locateError(unpackValue(ctx, node->eval(ctx, node)), node);
+        PARANOID_TYPES(node, val);
+        return val;
+    }
 
-    Token *tok = terminal->tok;
+    ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = node->tok->lexeme};
+    ExecValue *val = context_getValue(ctx, &identifier);
+    if (val == NULL && ctx->global != NULL)
+        val = context_getValue(ctx->global, &identifier);
 
-    switch (tok->type) {
-    case TOKEN_NULL:
-        return value_newNull();
-    case TOKEN_TRUE:
-        return value_newNumber(1.0, tok);
-    case TOKEN_FALSE:
-        return value_newNumber(0.0, tok);
-    case TOKEN_NUMBER:
-        return value_newNumber(tok->literal.literal_num, tok);
-    case TOKEN_STRING:
-        return value_newString(tok->literal.literal_str, tok);
-    case TOKEN_IDENTIFIER:
-        return value_newIdentifier(tok->lexeme, tok);
+    if (val == NULL) {
+        Error *nameErr = error_new(ERR_RUNTIME_NAME, MSG_UNDECLARED, -1, -1);
+        return value_locate(value_newError(error_withText(nameErr, node->tok->lexeme)), node->tok);
+    }
+    PARANOID_TYPES(node, val);
+    return val;
+}
+
+// Replaces the evaluator of `node`. A hoisted node keeps execHoisted(), and replaces the evaluator it caches instead.
+void relink(ASTNode *node, ExecValue *(*eval)(Context *ctx, ASTNode *node))
+{
+    if (node->hoist != NULL && node->eval == execHoisted)
+        node->hoist->eval = eval;
+    else
+        node->eval = eval;
+}
+
+// Applies the operator `op` to two numbers, and frees them. The result goes in whichever operand isn't shared,
+// or in a copy of `lVal` if both are.
+ExecValue *applyNumber(TokenType op, ExecValue *lVal, ExecValue *rVal)
+{
+    ExecValue *result = lVal, *other = rVal;
+    if (lVal->refCount > 1 && rVal->refCount == 1) {
+        result = rVal;
+        other = lVal;
+    }
+
+    // Integer operands stay integers as long as the result is exact
+    int64_t n;
+    if (lVal->isInt && rVal->isInt && value_intArith(op, lVal->value.literal_int, rVal->value.literal_int, &n)) {
+        result = value_own(result);
+        result->value.literal_int = n;
+        value_free(other);
+        return result;
+    }
+
+    double l = value_toDouble(lVal);
+    double r = value_toDouble(rVal);
+    switch (op) {
+    case TOKEN_PLUS:          l = l + r; break;
+    case TOKEN_MINUS:         l = l - r; break;
+    case TOKEN_STAR:          l = l * r; break;
+    case TOKEN_SLASH:         l = l / r; break;
+    case TOKEN_PERCENT:       l = fmod(l, r); break;
+    case TOKEN_CARET:         l = pow(l, r); break;
+    case TOKEN_EQUAL_EQUAL:   l = l == r; break;
+    case TOKEN_BANG_EQUAL:    l = !(l == r); break;
+    case TOKEN_GREATER:       l = l > r; break;
+    case TOKEN_GREATER_EQUAL: l = l >= r; break;
+    case TOKEN_LESS:          l = l < r; break;
+    case TOKEN_LESS_EQUAL:    l = l <= r; break;
     default:
-        criticalError("terminal: Invalid token for execTerminal");
+        criticalError("applyNumber: Unexpected operator.");
     }
-    return NULL;
+    result = value_own(result);
+    value_setNumber(result, l);
+    value_free(other);
+    return result;
 }
 
-ExecValue *execFnArgs(Context* ctx, ASTNode *fnArgs)
+// Returns the result of a binary node quickened to numbers, reusing `lVal`, or NULL if an operand isn't a number.
+// A node whose guard fails goes back to the generic path for good.
+ExecValue *quickNumber(ASTNode *node, ExecValue *lVal, ExecValue *rVal)
+{
+    if (lVal->type != TYPE_NUMBER || rVal->type != TYPE_NUMBER) {
+        node->quick = QUICK_GENERIC;
+        return NULL;
+    }
+    return applyNumber(node->op, lVal, rVal);
+}
+
+// Quickens a binary node after its first run, if both operands were numbers.
+void quicken(ASTNode *node, ExecValue *lVal, ExecValue *rVal)
+{
+    if (node->quick != QUICK_UNSEEN)
+        return;
+    node->quick = QUICK_GENERIC;
+    if (lVal->type != TYPE_NUMBER || rVal->type != TYPE_NUMBER)
+        return;
+
+    switch (node->op) {
+    case TOKEN_PLUS:          node->quick = QUICK_NUM_ADD; break;
+    case TOKEN_MINUS:         node->quick = QUICK_NUM_SUB; break;
+    case TOKEN_STAR:          node->quick = QUICK_NUM_MUL; break;
+    case TOKEN_SLASH:         node->quick = QUICK_NUM_DIV; break;
+    case TOKEN_PERCENT:       node->quick = QUICK_NUM_MOD; break;
+    case TOKEN_CARET:         node->quick = QUICK_NUM_POW; break;
+    case TOKEN_EQUAL_EQUAL:   node->quick = QUICK_NUM_EQ; break;
+    case TOKEN_BANG_EQUAL:    node->quick = QUICK_NUM_NEQ; break;
+    case TOKEN_GREATER:       node->quick = QUICK_NUM_GT; break;
+    case TOKEN_GREATER_EQUAL: node->quick = QUICK_NUM_GEQ; break;
+    case TOKEN_LESS:          node->quick = QUICK_NUM_LT; break;
+    case TOKEN_LESS_EQUAL:    node->quick = QUICK_NUM_LEQ; break;
+    default: break;
+    }
+    if (node->quick > QUICK_GENERIC)
+        relink(node, execQuickBinary);
+}
+
+ExecValue *execNull(Context* ctx, ASTNode *terminal)
+{
+    PARANOID_EXPECT(terminal, SYM_TERMINAL);
+    return value_newNull();
+}
+
+ExecValue *execTrue(Context* ctx, ASTNode *terminal)
+{
+    PARANOID_EXPECT(terminal, SYM_TERMINAL);
+    return value_newNumber(1.0);
+}
+
+ExecValue *execFalse(Context* ctx, ASTNode *terminal)
+{
+    PARANOID_EXPECT(terminal, SYM_TERMINAL);
+    return value_newNumber(0.0);
+}
+
+ExecValue *execNumber(Context* ctx, ASTNode *terminal)
+{
+    PARANOID_EXPECT(terminal, SYM_TERMINAL);
+    return value_newNumber(terminal->tok->literal.literal_num);
+}
+
+ExecValue *execString(Context* ctx, ASTNode *terminal)
+{
+    PARANOID_EXPECT(terminal, SYM_TERMINAL);
+    return value_newStringRef(stringref_retain(terminal->tok->literal.literal_str));
+}
+
+ExecValue *execIdentifier(Context* ctx, ASTNode *terminal)
+{
+    PARANOID_EXPECT(terminal, SYM_TERMINAL);
+    return value_newIdentifier(terminal->tok->lexeme);
+}
+
+ExecValue *execForward(Context* ctx, ASTNode *node)
 {
-    if (fnArgs->type != SYM_FN_ARGS)
-        criticalError("fnArgs: Invalid symbol type, expected SYM_FN_ARGS");
+    PARANOID_CHILDREN(node, node->type == SYM_PRIMARY ? node->numChildren : 1);
+    return node->lhs->eval(ctx, node->lhs);
+}
 
+ExecValue *execFnArgs(Context* ctx, ASTNode *fnArgs)
+{
+    PARANOID_EXPECT(fnArgs, SYM_FN_ARGS);
     size_t curFnArgCount = 0;
     for (size_t i = 0; i < fnArgs->numChildren; i++) {
         ASTNode *child = fnArgs->children[i];
-        if (child->type == SYM_EXPR) {
-            curFnArgCount += 1;
-            if (curFnArgCount > ctx->argCount) {
-              Error *szError = error_new(ERR_RUNTIME, -1, -1);
-              snprintf(szError->message, MAX_ERRMSG_LEN,
-                       "Too many arguments provided to function.");
-              return value_newError(szError, child->tok);
-            }
-            // the PARENT context is used to get the value.
-            ExecValue *value = execExpr(ctx->parent, child);
-            if (value->type == TYPE_ERROR)
-              return value;
-
-            value = unpackValue(ctx->parent, value);
-
-            // Assign the value within the function context
-            ExecSymbol *fnSym = ctx->symbols[curFnArgCount - 1];
-            value_free(fnSym->value);
-            fnSym->value = value_clone(value);
-            value_free(value);
-        } else if (child->type == SYM_TERMINAL && child->tok->type == TOKEN_COMMA) {
+        if (child->type != SYM_EXPR)
             continue;
-        } else {
-            criticalError("fnArgs: Unexpected child in arglist.");
+
+        curFnArgCount += 1;
+        if (curFnArgCount > ctx->argCount) {
+          Error *szError = error_new(ERR_RUNTIME, MSG_TOO_MANY_ARGS, -1, -1);
+          return locateError(value_newError(szError), child);
         }
+        // the PARENT context is used to get the value.
+        ExecValue *value = execOperand(ctx->parent, child->lhs);
+        if (value->type == TYPE_ERROR)
+          return value;
+
+        // Assign the value within the function context
+        ExecSymbol *fnSym = ctx->symbols[curFnArgCount - 1];
+        value_free(fnSym->value);
+        fnSym->value = value;
     }
 
     // Check if all values in ctx have been assigned
     for (size_t i = 0; i < ctx->symbolCount; i++) {
         ExecSymbol *sym = ctx->symbols[i];
         if (sym->value->type == TYPE_UNASSIGNED) {
-            Error *unasErr = error_new(ERR_RUNTIME, -1, -1);
-            snprintf(unasErr->message, MAX_ERRMSG_LEN, "Too little arguments provided to function.");
-            return value_newError(unasErr, fnArgs->parent->children[0]->tok);
+            Error *unasErr = error_new(ERR_RUNTIME, MSG_TOO_FEW_ARGS, -1, -1);
+            return locateError(value_newError(unasErr), fnArgs->parent);
         }
     }
 
@@ -108,605 +276,384 @@ ExecValue *execFnArgs(Context* ctx, ASTNode *fnArgs)
 
 ExecValue *execFnCall(Context* ctx, ASTNode *fnCall)
 {
-    if (fnCall->type != SYM_FN_CALL)
-        criticalError("fnCall: Invalid symbol type, expected SYM_FN_CALL");
-
-    if (fnCall->numChildren != 4)
-        criticalError("fnCall: Expected 4 children.");
-    if (fnCall->children[0]->type != SYM_TERMINAL || fnCall->children[0]->tok->type != TOKEN_IDENTIFIER)
-        criticalError("fnCall: Invalid child 1, expected an identifier.");
-    
+    PARANOID_EXPECT(fnCall, SYM_FN_CALL);
     // Get identifier, check in ctx
-    ExecValue *identifier = execTerminal(ctx, fnCall->children[0]);
-    ExecValue *val = context_getValue(ctx, identifier);
-    if (val == NULL && ctx->global != NULL)
-        val = context_getValue(ctx->global, identifier);
-    
+    Token *nameTok = fnCall->lhs->tok;
+    ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = nameTok->lexeme};
+    ExecValue *val = context_getValue(ctx, &identifier);
+    int isGlobal = ctx->global == NULL;
+    if (val == NULL && ctx->global != NULL) {
+        val = context_getValue(ctx->global, &identifier);
+        isGlobal = 1;
+    }
+
     if (val == NULL) {
-        Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-        snprintf(typeErr->message, MAX_ERRMSG_LEN, "No such identifier %s", identifier->value.identifier_name);
-        value_free(identifier);
-        return value_newError(typeErr, identifier->tok);
+        Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_NO_SUCH_IDENTIFIER, -1, -1);
+        return value_locate(value_newError(error_withText(typeErr, nameTok->lexeme)), nameTok);
     }
     if (val->type != TYPE_FUNCTION) {
-        Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-        snprintf(typeErr->message, MAX_ERRMSG_LEN, "Identifier %s is not a function.", identifier->value.identifier_name);
-        value_free(identifier);
+        Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_NOT_A_FUNCTION, -1, -1);
         value_free(val);
-        return value_newError(typeErr, identifier->tok);
+        return value_locate(value_newError(error_withText(typeErr, nameTok->lexeme)), nameTok);
     }
     FunctionRef *fnRef = val->value.function_ref;
-    ASTNode *fnArgList = fnRef->argList;
-    ASTNode *fnBlk = fnRef->fnBlk;
-    ASTNode *fnArgs = fnCall->children[2];
-    if (fnArgList->type != SYM_ARG_LIST)
-        criticalError("fnCall: Referenced function ref's arg list is not SYM_ARG_LIST");
-    if (fnBlk->type != SYM_BLOCK)
-        criticalError("fnCall: Referenced function ref's block is not SYM_BLOCK");
-    if (fnArgs->type != SYM_FN_ARGS)
-        criticalError("fnCall: Arguments for function call not of type SYM_FN_ARGS");
-    
+    fnCalls++;
+
+    // Small global functions are evaluated in place, without a context of their own
+    if (isGlobal) {
+        ExecValue *inlined = inliner_call(ctx, fnCall, fnRef);
+        if (inlined != NULL) {
+            value_free(val);
+            return inlined;
+        }
+    }
+
     // if exists, create new context with specific arg count
     Context *fnCtx = context_new(ctx, ctx->global);
     if (ctx->global == NULL)
         fnCtx->global = ctx;
-    
+
     fnCtx->argCount = 0;
-    
+
+    // Errors in the parameters and the body are in the source the function was defined in
+    ErrorContext *callerErrorCtx = errorContext;
+
     // Call linked arglist
-    ExecValue *errVal = execArgList(fnCtx, fnArgList);
+    errorContext = fnRef->errorCtx;
+    ExecValue *errVal = execArgList(fnCtx, fnRef->argList);
+    errorContext = callerErrorCtx;
     if (errVal->type == TYPE_ERROR) {
-        value_free(identifier);
+        context_free(fnCtx);
         value_free(val);
         return errVal;
     }
     value_free(errVal);
-    
+
     // Call fnargs
-    errVal = execFnArgs(fnCtx, fnArgs);
+    errVal = execFnArgs(fnCtx, fnCall->rhs);
     if (errVal->type == TYPE_ERROR) {
-        value_free(identifier);
+        context_free(fnCtx);
         value_free(val);
         return errVal;
     }
     value_free(errVal);
-    value_free(identifier);
-    
-    // Call linked block until return
-    ExecValue *retVal = execBlock(fnCtx, fnBlk);
-    return retVal;
-}
 
-ExecValue *execPrimary(Context* ctx, ASTNode *primary)
-{
-    if (primary->type != SYM_PRIMARY)
-        criticalError("primary: Invalid symbol type, expected SYM_PRIMARY");
-    
-    // Check if primary is ( EXPR ) or TERMINAL or FN_CALL
-    if (primary->numChildren == 1) {
-        ASTNode *child = primary->children[0];
-        if (child->type == SYM_TERMINAL)
-            return execTerminal(ctx, child);
-        else if (child->type == SYM_FN_CALL)
-            return execFnCall(ctx, child);
-        
-        criticalError("primary: Expected a TERMINAL or FN_CALL.");
-        return NULL;
-    }
-    
-    if (primary->numChildren == 3) {
-      if (primary->children[0]->tok->type != TOKEN_PAREN_L ||
-          primary->children[2]->tok->type != TOKEN_PAREN_R)
-        criticalError("primary: Expected ( EXPR ), instead given invalid "
-                      "expression with 3 children.");
-      return execExpr(ctx, primary->children[1]);
-    }
-
-    criticalError("primary: Expected 1 or 3 children.");
-    return NULL;
-}
-
-ExecValue *execPower(Context* ctx, ASTNode *power)
-{
-    if (power->type != SYM_POWER)
-        criticalError("power: Invalid symbol type, expected SYM_POWER");
-    
-    // Check if power is PRIMARY ^ UNARY or PRIMARY
-    if (power->numChildren == 1)
-        return execPrimary(ctx, power->children[0]);
-    if (power->numChildren == 3) {
-        ExecValue *lVal = execPrimary(ctx, power->children[0]);
-        ExecValue *rVal = execUnary(ctx, power->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
+    // Pure functions return the cached result for arguments they were already called with
+    FnMemo *memo = fnRef->memo;
+    int isPure = memo_isPure(fnRef, fnCtx->global);
+    if (isPure) {
+        if (memo->name == NULL)
+            memo->name = mem_strdup(nameTok->lexeme);
+        ExecValue *cached = memo_lookup(memo, fnCtx);
+        if (cached != NULL) {
+            context_free(fnCtx);
+            value_free(val);
+            return cached;
         }
-
-        TokenType op = power->children[1]->tok->type;
-        if (op != TOKEN_CARET)
-            criticalError("power: Unexpected operator, expected ^.");
-        retVal = value_opPow(lVal, rVal);
-        value_free(lVal); value_free(rVal);
-        return retVal;
     }
 
-    criticalError("power: Expected 1 or 3 children.");
-    return NULL;
+    // Hot numeric functions run without boxing their values, otherwise call linked block until return
+    ExecValue *retVal = numeric_call(fnRef, fnCtx);
+    if (retVal == NULL) {
+        errorContext = fnRef->errorCtx;
+        retVal = execBlock(fnCtx, fnRef->fnBlk);
+        errorContext = callerErrorCtx;
+    }
+    if (isPure && retVal->type != TYPE_ERROR)
+        memo_store(memo, fnCtx, retVal);
+    context_free(fnCtx);
+    value_free(val);
+    return retVal;
 }
 
-ExecValue *execUnary(Context* ctx, ASTNode *unary)
+ExecValue *execTracedFnCall(Context* ctx, ASTNode *fnCall)
 {
-    if (unary->type != SYM_UNARY)
-        criticalError("unary: Invalid symbol type, expected SYM_UNARY");
-    
-    // Check if unary is +/- UNARY or POWER
-    if (unary->numChildren == 1)
-        return execPower(ctx, unary->children[0]);
-    if (unary->numChildren == 2) {
-        ExecValue *rVal = execUnary(ctx, unary->children[1]);
-        ExecValue *retVal = NULL;
-        TokenType op = unary->children[0]->tok->type;
-        
-        rVal = unpackValue(ctx, rVal);
-        if (rVal->type == TYPE_ERROR)
-            return rVal;
-
-        switch (op) {
-        case TOKEN_PLUS:  retVal = value_opUnaryPos(rVal); break;
-        case TOKEN_MINUS: retVal = value_opUnaryNeg(rVal); break;
-        default:
-            criticalError("unary: Unexpected operator.");
-        }
-        value_free(rVal);
-        return retVal;
-    }
-
-    criticalError("unary: Expected 1 or 2 children.");
-    return NULL;
+    double start = trace_now();
+    ExecValue *retVal = execFnCall(ctx, fnCall);
+    Token *nameTok = fnCall->lhs->tok;
+    trace_span(nameTok->lexeme, "call", start, nameTok->lineNum + 1);
+    return retVal;
 }
 
-ExecValue *execTerm(Context* ctx, ASTNode *term)
+ExecValue *execProfiledFnCall(Context* ctx, ASTNode *fnCall)
 {
-    if (term->type != SYM_TERM)
-        criticalError("term: Invalid symbol type, expected SYM_TERM.");
-
-    // Check if term is TERM OP UNARY or UNARY
-    if (term->numChildren == 1)
-        return execUnary(ctx, term->children[0]);
-    if (term->numChildren == 3) {
-        ExecValue *lVal = execTerm(ctx, term->children[0]);
-        ExecValue *rVal = execUnary(ctx, term->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
-        }
-
-        TokenType op = term->children[1]->tok->type;
+    Token *nameTok = fnCall->lhs->tok;
+    profile_enter(nameTok->lexeme, nameTok->lineNum + 1);
+    ExecValue *retVal = trace_enabled() ? execTracedFnCall(ctx, fnCall) : execFnCall(ctx, fnCall);
+    profile_exit();
+    return retVal;
+}
 
-        switch (op) {
-        case TOKEN_STAR:    retVal = value_opMul(lVal, rVal); break;
-        case TOKEN_SLASH:   retVal = value_opDiv(lVal, rVal); break;
-        case TOKEN_PERCENT: retVal = value_opMod(lVal, rVal); break;
-        default:
-            criticalError("term: Unexpected operator.");
-        }
-        value_free(lVal); value_free(rVal);
-        return retVal;
+// Applies the operator of a binary node to its unpacked operands, and frees them.
+ExecValue *applyBinary(ASTNode *node, ExecValue *lVal, ExecValue *rVal)
+{
+    ExecValue *retVal = NULL;
+    switch (node->op) {
+    case TOKEN_OR:            retVal = value_opOr(lVal, rVal); break;
+    case TOKEN_AND:           retVal = value_opAnd(lVal, rVal); break;
+    case TOKEN_EQUAL_EQUAL:   retVal = value_opEqEq(lVal, rVal); break;
+    case TOKEN_BANG_EQUAL:    retVal = value_opNEq(lVal, rVal); break;
+    case TOKEN_GREATER:       retVal = value_opGt(lVal, rVal); break;
+    case TOKEN_GREATER_EQUAL: retVal = value_opGEq(lVal, rVal); break;
+    case TOKEN_LESS:          retVal = value_opLt(lVal, rVal); break;
+    case TOKEN_LESS_EQUAL:    retVal = value_opLEq(lVal, rVal); break;
+    case TOKEN_PLUS:          retVal = value_opAdd(lVal, rVal); break;
+    case TOKEN_MINUS:         retVal = value_opSub(lVal, rVal); break;
+    case TOKEN_STAR:          retVal = value_opMul(lVal, rVal); break;
+    case TOKEN_SLASH:         retVal = value_opDiv(lVal, rVal); break;
+    case TOKEN_PERCENT:       retVal = value_opMod(lVal, rVal); break;
+    case TOKEN_CARET:         retVal = value_opPow(lVal, rVal); break;
+    default:
+        criticalError("binary: Unexpected operator.");
     }
-    criticalError("term: Expected 1 or 3 children.");
-    return NULL;
+    if (retVal->type == TYPE_ERROR)
+        locateError(retVal, retVal->rightOperand ? node->rhs : node->lhs);
+    quicken(node, lVal, rVal);
+    value_free(lVal); value_free(rVal);
+    return retVal;
 }
 
-ExecValue *execSum(Context* ctx, ASTNode *sum)
+ExecValue *execBinary(Context* ctx, ASTNode *node)
 {
-    if (sum->type != SYM_SUM)
-        criticalError("sum: Invalid symbol type, expected SYM_SUM.");
-
-    // Check if sum is SUM OP TERM or SUM
-    if (sum->numChildren == 1)
-        return execTerm(ctx, sum->children[0]);
-    if (sum->numChildren == 3) {
-        ExecValue *lVal = execSum(ctx, sum->children[0]);
-        ExecValue *rVal = execTerm(ctx, sum->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
-        }
-
-        TokenType op = sum->children[1]->tok->type;
-
-        switch (op) {
-        case TOKEN_PLUS:  retVal = value_opAdd(lVal, rVal); break;
-        case TOKEN_MINUS: retVal = value_opSub(lVal, rVal); break;
-        default:
-            criticalError("sum: Unexpected operator.");
-        }
-        value_free(lVal); value_free(rVal);
-        return retVal;
+    PARANOID_CHILDREN(node, 3);
+    ExecValue *lVal = execOperand(ctx, node->lhs);
+    ExecValue *rVal = execOperand(ctx, node->rhs);
+    if (lVal->type == TYPE_ERROR) {
+        value_free(rVal);
+        return lVal;
+    } else if (rVal->type == TYPE_ERROR) {
+        value_free(lVal);
+        return rVal;
     }
-    criticalError("sum: Expected 1 or 3 children.");
-    return NULL;
+    return applyBinary(node, lVal, rVal);
 }
 
-ExecValue *execComparison(Context* ctx, ASTNode *comparison)
+ExecValue *execQuickBinary(Context* ctx, ASTNode *node)
 {
-    if (comparison->type != SYM_COMPARISON)
-        criticalError("comparison: Invalid symbol type, expected SYM_COMPARISON.");
-
-    // Check if comparison is SUM OP COMPARISON or SUM
-    if (comparison->numChildren == 1)
-        return execSum(ctx, comparison->children[0]);
-    if (comparison->numChildren == 3) {
-        ExecValue *lVal = execComparison(ctx, comparison->children[0]);
-        ExecValue *rVal = execSum(ctx, comparison->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
-        }
-
-        TokenType op = comparison->children[1]->tok->type;
+    PARANOID_CHILDREN(node, 3);
+    ExecValue *lVal = execOperand(ctx, node->lhs);
+    ExecValue *rVal = execOperand(ctx, node->rhs);
+    if (lVal->type == TYPE_ERROR) {
+        value_free(rVal);
+        return lVal;
+    } else if (rVal->type == TYPE_ERROR) {
+        value_free(lVal);
+        return rVal;
+    }
 
-        switch (op) {
-        case TOKEN_GREATER:       retVal = value_opGt(lVal, rVal); break;
-        case TOKEN_GREATER_EQUAL: retVal = value_opGEq(lVal, rVal); break;
-        case TOKEN_LESS:          retVal = value_opLt(lVal, rVal); break;
-        case TOKEN_LESS_EQUAL:    retVal = value_opLEq(lVal, rVal); break;
-        default:
-            criticalError("comparison: Unexpected operator.");
-        }
-        value_free(lVal); value_free(rVal);
+    ExecValue *retVal = quickNumber(node, lVal, rVal);
+    if (retVal != NULL)
         return retVal;
-    }
-    criticalError("comparison: Expected 1 or 3 children.");
-    return NULL;
+    relink(node, execBinary);
+    return applyBinary(node, lVal, rVal);
 }
 
-ExecValue *execEquality(Context* ctx, ASTNode *equality)
+// Evaluates both operands of a binary node. Returns 0 and sets `*err` to the first error, if there is one.
+int typedOperands(Context *ctx, ASTNode *node, ExecValue **lVal, ExecValue **rVal, ExecValue **err)
 {
-    if (equality->type != SYM_EQUALITY)
-        criticalError("equality: Invalid symbol type, expected SYM_EQUALITY.");
-
-    // Check if equality is COMPARISON OP EQUALITY or COMPARISON
-    if (equality->numChildren == 1)
-        return execComparison(ctx, equality->children[0]);
-    if (equality->numChildren == 3) {
-        ExecValue *lVal = execEquality(ctx, equality->children[0]);
-        ExecValue *rVal = execComparison(ctx, equality->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
-        }
-
-        TokenType op = equality->children[1]->tok->type;
-
-        switch (op) {
-        case TOKEN_EQUAL_EQUAL: retVal = value_opEqEq(lVal, rVal); break;
-        case TOKEN_BANG_EQUAL:  retVal = value_opNEq(lVal, rVal); break;
-        default:
-            criticalError("equality: Unexpected operator.");
-        }
-        value_free(lVal); value_free(rVal);
-        return retVal;
+    *lVal = execOperand(ctx, node->lhs);
+    *rVal = execOperand(ctx, node->rhs);
+    if ((*lVal)->type == TYPE_ERROR) {
+        value_free(*rVal);
+        *err = *lVal;
+        return 0;
+    } else if ((*rVal)->type == TYPE_ERROR) {
+        value_free(*lVal);
+        *err = *rVal;
+        return 0;
     }
-    criticalError("equality: Expected 1 or 3 children.");
-    return NULL;
+    return 1;
 }
-ExecValue* execLogUnary(Context* ctx, ASTNode* logUnary)
-{
-    if (logUnary->type != SYM_LOG_UNARY)
-        criticalError("logUnary: Invalid symbol type, expected SYM_LOG_UNARY");
 
-    // Check if expr is not LOG_UNARY | EQUALITY
-    if (logUnary->numChildren == 1)
-        return execEquality(ctx, logUnary->children[0]);
-    if (logUnary->numChildren == 2) {
-        ExecValue *rVal = execLogUnary(ctx, logUnary->children[1]);
-        ExecValue *retVal = NULL;
-        TokenType op = logUnary->children[0]->tok->type;
-        
-        rVal = unpackValue(ctx, rVal);
-        if (rVal->type == TYPE_ERROR)
-            return rVal;
+ExecValue *execTypedNumber(Context* ctx, ASTNode *node)
+{
+    PARANOID_CHILDREN(node, 3);
+    ExecValue *lVal, *rVal, *err;
+    if (!typedOperands(ctx, node, &lVal, &rVal, &err))
+        return err;
+    return applyNumber(node->op, lVal, rVal);
+}
 
-        if (op == TOKEN_NOT)
-            retVal = value_opNot(rVal);
-        else
-            criticalError("logUnary: Unexpected operator.");
+ExecValue *execTypedConcat(Context* ctx, ASTNode *node)
+{
+    PARANOID_CHILDREN(node, 3);
+    ExecValue *lVal, *rVal, *err;
+    if (!typedOperands(ctx, node, &lVal, &rVal, &err))
+        return err;
+    ExecValue *retVal = value_concat(lVal, rVal);
+    value_free(lVal); value_free(rVal);
+    return retVal;
+}
 
-        value_free(rVal);
+ExecValue *execFusedCompare(Context* ctx, ASTNode *comparison)
+{
+    PARANOID_EXPECT(comparison, SYM_COMPARISON);
+    ExecValue *retVal = fusion_compare(ctx, comparison);
+    if (retVal != NULL)
         return retVal;
-    }
-
-    criticalError("logUnary: Expected 1 or 2 children.");
-    return NULL;
+    relink(comparison, execBinary);
+    return execBinary(ctx, comparison);
 }
 
-ExecValue* execAndExpr(Context* ctx, ASTNode* andExpr)
+ExecValue *execFusedModEq(Context* ctx, ASTNode *equality)
 {
-    if (andExpr->type != SYM_AND_EXPR)
-        criticalError("andExpr: Invalid symbol type, expected SYM_AND_EXPR");
-
-    // Check if expr is AND_EXPR and LOG_UNARY | LOG_UNARY
-    if (andExpr->numChildren == 1)
-        return execLogUnary(ctx, andExpr->children[0]);
-    if (andExpr->numChildren == 3) {
-        ExecValue *lVal = execAndExpr(ctx, andExpr->children[0]);
-        ExecValue *rVal = execLogUnary(ctx, andExpr->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
-        }
-
-        retVal = value_opAnd(lVal, rVal);
-        value_free(lVal); value_free(rVal);
-
+    PARANOID_EXPECT(equality, SYM_EQUALITY);
+    ExecValue *retVal = fusion_modEq(ctx, equality);
+    if (retVal != NULL)
         return retVal;
-    }
-    criticalError("andExpr: Expected 1 or 3 children.");
-    return NULL;
+    relink(equality, execBinary);
+    return execBinary(ctx, equality);
 }
 
-ExecValue* execOrExpr(Context* ctx, ASTNode* orExpr)
+ExecValue *execHoisted(Context* ctx, ASTNode *node)
 {
-    if (orExpr->type != SYM_OR_EXPR)
-        criticalError("orExpr: Invalid symbol type, expected SYM_OR_EXPR");
-
-    // Check if expr is OR_EXPR or AND_EXPR  |  AND_EXPR
-    if (orExpr->numChildren == 1)
-        return execAndExpr(ctx, orExpr->children[0]);
-    if (orExpr->numChildren == 3) {
-        ExecValue *lVal = execOrExpr(ctx, orExpr->children[0]);
-        ExecValue *rVal = execAndExpr(ctx, orExpr->children[2]);
-        ExecValue *retVal = NULL;
-
-        lVal = unpackValue(ctx, lVal);
-        rVal = unpackValue(ctx, rVal);
-        if (lVal->type == TYPE_ERROR) {
-            value_free(rVal);
-            return lVal;
-        } else if (rVal->type == TYPE_ERROR) {
-            value_free(lVal);
-            return rVal;
-        }
-
-        retVal = value_opOr(lVal, rVal);
-        value_free(lVal); value_free(rVal);
+    ExecValue *val = hoist_lookup(node);
+    if (val != NULL)
+        return val;
+    val = node->hoist->eval(ctx, node);
+    hoist_store(node, val);
+    return val;
+}
 
-        return retVal;
+ExecValue *execUnary(Context* ctx, ASTNode *unary)
+{
+    PARANOID_CHILDREN(unary, 2);
+    ExecValue *rVal = execOperand(ctx, unary->rhs);
+    ExecValue *retVal = NULL;
+    if (rVal->type == TYPE_ERROR)
+        return rVal;
+
+    switch (unary->op) {
+    case TOKEN_PLUS:  retVal = value_opUnaryPos(rVal); break;
+    case TOKEN_MINUS: retVal = value_opUnaryNeg(rVal); break;
+    case TOKEN_NOT:   retVal = value_opNot(rVal); break;
+    default:
+        criticalError("unary: Unexpected operator.");
     }
-    criticalError("orExpr: Expected 1 or 3 children.");
-    return NULL;
+    value_free(rVal);
+    return locateError(retVal, unary->rhs);
 }
 
 ExecValue* execArg(Context* ctx, ASTNode* arg)
 {
-    if (arg->type != SYM_ARG)
-        criticalError("arg: Invalid symbol type, expected SYM_ARG");
-
+    PARANOID_EXPECT(arg, SYM_ARG);
     // Could be IDENTIFIER or IDENTIFIER = TERMINAL
-    if (arg->numChildren == 1) {
-        ExecValue *identifier = execTerminal(ctx, arg->children[0]);
-        
-        if (context_getSymbol(ctx, identifier) != NULL) {
-            Error *execError = error_new(ERR_RUNTIME, -1, -1);
-            snprintf(execError->message, MAX_ERRMSG_LEN, "Function parameter has the same identifier name \"%s\"", identifier->value.identifier_name);
-            ExecValue *errVal = value_newError(execError, identifier->tok);
-            value_free(identifier);
-            return errVal;
-        }
-        context_addSymbol(ctx, identifier);
-    } else if (arg->numChildren == 3) {
-        ExecValue *identifier = execTerminal(ctx, arg->children[0]);
-        ExecValue *defaultValue = execTerminal(ctx, arg->children[1]); //TODO: change to expr in here and in grammar
-        if (arg->children[1]->type != SYM_TERMINAL || arg->children[1]->tok->type != TOKEN_EQUAL)
-            criticalError("arg: Second child of assignment not an equals.");
-        
-        if (context_getSymbol(ctx, identifier) != NULL) {
-            Error *execError = error_new(ERR_RUNTIME, -1, -1);
-            snprintf(execError->message, MAX_ERRMSG_LEN, "Function parameter has the same identifier name \"%s\"", identifier->value.identifier_name);
-            ExecValue *errVal = value_newError(execError, identifier->tok);
-            value_free(identifier);
-            return errVal;
-        }
-        context_addSymbol(ctx, identifier);
+    ExecValue *identifier = execIdentifier(ctx, arg->lhs);
+    if (context_getSymbol(ctx, identifier) != NULL) {
+        Error *execError = error_new(ERR_RUNTIME, MSG_DUPLICATE_PARAM, -1, -1);
+        error_withText(execError, identifier->value.identifier_name);
+        ExecValue *errVal = value_locate(value_newError(execError), arg->lhs->tok);
+        value_free(identifier);
+        return errVal;
+    }
+    context_addSymbol(ctx, identifier);
+
+    if (arg->rhs != NULL) {
+        ExecValue *defaultValue = arg->rhs->eval(ctx, arg->rhs);
         context_setSymbol(ctx, identifier, defaultValue);
         value_free(defaultValue);
     }
-    
+    value_free(identifier);
     return value_newNull();
 }
 
 // Called by the function call to add the context variables
 ExecValue* execArgList(Context* ctx, ASTNode* argList)
 {
-    if (argList->type != SYM_ARG_LIST)
-        criticalError("argList: Invalid symbol type, expected SYM_ARG_LIST");
-
+    PARANOID_EXPECT(argList, SYM_ARG_LIST);
     // Add each symbol to the list
     for (size_t i = 0; i < argList->numChildren; i++) {
         ASTNode *child = argList->children[i];
-        ExecValue *errVal;
-        if (child->type == SYM_ARG) {
-            errVal = execArg(ctx, child);
-            ctx->argCount += 1;
-        } else if (child->type == SYM_TERMINAL && child->tok->type == TOKEN_COMMA) {
+        if (child->type != SYM_ARG)
             continue;
-        } else {
-            criticalError("argList: Unexpected child in arglist.");
-        }
+
+        ExecValue *errVal = execArg(ctx, child);
+        ctx->argCount += 1;
         if (errVal->type == TYPE_ERROR)
             return errVal;
-        
+
         value_free(errVal);
     }
-    
+
     return value_newNull();
 }
 
 // Returns the function reference variable, with the argList and block. This will be stored in the current context
 ExecValue* execFnExpr(Context* ctx, ASTNode* fnExpr)
 {
-    if (fnExpr->type != SYM_FN_EXPR)
-        criticalError("fnExpr: Invalid symbol type, expected SYM_FN_EXPR");
-
-    // Validate the various symbols first
-    if (fnExpr->numChildren != 8)
-        criticalError("fnExpr: Expected 8 children.");
-    if (fnExpr->children[2]->type != SYM_ARG_LIST || fnExpr->children[5]->type != SYM_BLOCK)
-        criticalError("fnExpr: Expected child 2 to be ARG_LIST, child 5 to be BLOCK.");
-    
-    ASTNode *argList = fnExpr->children[2];
-    ASTNode *block = fnExpr->children[5];
-    
-    return value_newFunction(argList, block, fnExpr->tok);
-}
-
-ExecValue *execExpr(Context* ctx, ASTNode *expr)
-{
-    if (expr->type != SYM_EXPR)
-        criticalError("expr: Invalid symbol type, expected SYM_EXPR");
-
-    if (expr->numChildren != 1)
-        criticalError("expr: Expected 1 child.");
+    PARANOID_EXPECT(fnExpr, SYM_FN_EXPR);
+    ExecValue *fnVal = value_newFunction(fnExpr->lhs, fnExpr->rhs);
 
-    if (expr->children[0]->type == SYM_OR_EXPR)
-        return execOrExpr(ctx, expr->children[0]);
-    else if(expr->children[0]->type == SYM_FN_EXPR)
-        return execFnExpr(ctx, expr->children[0]);
-    criticalError("expr: Expected a child.");
-    return NULL;
+    // The function has its own copy of the tree, which needs its own operand links
+    execLower(fnVal->value.function_ref->argList);
+    execLower(fnVal->value.function_ref->fnBlk);
+    return fnVal;
 }
 
 ExecValue *execPrntStmt(Context* ctx, ASTNode *prntStmt)
 {
-    if (prntStmt->type != SYM_PRNT_STMT)
-        criticalError("prntStmt: Invalid symbol type, expected SYM_PRNT_STMT");
-    if (prntStmt->numChildren == 1 && prntStmt->children[0]->tok->type == TOKEN_PRINT) {
+    PARANOID_EXPECT(prntStmt, SYM_PRNT_STMT);
+    if (prntStmt->lhs == NULL) {
         log_message(&consoleLogger,"\n");
         log_message(&executionLogger,"\n");
         log_message(&resultLogger,"\n");
         return value_newNull();
     }
-    if (prntStmt->numChildren == 3 &&
-	prntStmt->children[0]->tok->type == TOKEN_PRINT &&
-	prntStmt->children[1]->type == SYM_EXPR &&
-	prntStmt->children[2]->tok->type == TOKEN_NL) {
-		ExecValue *exprResult = execExpr(ctx, prntStmt->children[1]);
-        
-        exprResult = unpackValue(ctx, exprResult);
-        if (exprResult->type == TYPE_ERROR)
-            return exprResult;
-		
-		switch (exprResult->type) {
-        case TYPE_IDENTIFIER:
-            criticalError("prntStmt: Identifier's value was an identifier.");
-            break;
-        case TYPE_STRING:
-            log_message(&consoleLogger,"%s\n", exprResult->value.literal_str);
-            log_message(&executionLogger,"%s\n", exprResult->value.literal_str);
-            log_message(&resultLogger,"%s\n", exprResult->value.literal_str);
-            break;
-        case TYPE_NUMBER:
-            log_message(&consoleLogger,"%g\n", exprResult->value.literal_num);
-            log_message(&executionLogger,"%g\n", exprResult->value.literal_num);
-            log_message(&resultLogger,"%g\n", exprResult->value.literal_num);
-            break;
-        case TYPE_NULL:
-            log_message(&consoleLogger,"null\n");
-            log_message(&executionLogger,"null\n");
-            log_message(&resultLogger,"null\n");
-            break;
-        default:
-            criticalError("prntStmt: Unexpected type in exprResult.");
-        }
-		value_free(exprResult);
-		return value_newNull();
+
+    ExecValue *exprResult = execOperand(ctx, prntStmt->lhs);
+    if (exprResult->type == TYPE_ERROR)
+        return exprResult;
+
+    switch (exprResult->type) {
+    case TYPE_IDENTIFIER:
+        criticalError("prntStmt: Identifier's value was an identifier.");
+        break;
+    case TYPE_STRING:
+        log_message(&consoleLogger,"%s\n", value_str(exprResult));
+        log_message(&executionLogger,"%s\n", value_str(exprResult));
+        log_message(&resultLogger,"%s\n", value_str(exprResult));
+        break;
+    case TYPE_NUMBER:
+        log_message(&consoleLogger,"%g\n", value_toDouble(exprResult));
+        log_message(&executionLogger,"%g\n", value_toDouble(exprResult));
+        log_message(&resultLogger,"%g\n", value_toDouble(exprResult));
+        break;
+    case TYPE_NULL:
+        log_message(&consoleLogger,"null\n");
+        log_message(&executionLogger,"null\n");
+        log_message(&resultLogger,"null\n");
+        break;
+    default:
+        criticalError("prntStmt: Unexpected type in exprResult.");
     }
-    criticalError("prntstmt: Invalid print statement.");
-    return NULL;
+    value_free(exprResult);
+    return value_newNull();
 }
 
 ExecValue *execExprStmt(Context* ctx, ASTNode *exprStmt)
 {
-    if (exprStmt->type != SYM_EXPR_STMT)
-        criticalError("exprStmt: Invalid symbol type, expected SYM_EXPR_STMT");
-    if (exprStmt->numChildren == 2 &&
-        exprStmt->children[0]->type == SYM_EXPR &&
-        exprStmt->children[1]->tok->type == TOKEN_NL) {
-        ExecValue *exprResult = execExpr(ctx, exprStmt->children[0]);
-        if (exprResult->type == TYPE_ERROR)
-            return exprResult;
-        value_free(exprResult);
-        return value_newNull();
-    }
-    criticalError("exprStmt: Invalid exprStmt.");
-    return NULL;
+    PARANOID_EXPECT(exprStmt, SYM_EXPR_STMT);
+    ExecValue *exprResult = exprStmt->lhs->eval(ctx, exprStmt->lhs);
+    if (exprResult->type == TYPE_ERROR)
+        return exprResult;
+    value_free(exprResult);
+    return value_newNull();
 }
 
 ExecValue *execReturn(Context *ctx, ASTNode *ret)
 {
-    if (ret->type != SYM_RETURN)
-        criticalError("return: Invalid symbol type, expected SYM_RETURN");
-
+    PARANOID_EXPECT(ret, SYM_RETURN);
     ctx->hasReturn = 1;
 
-    if (ret->numChildren == 2)
+    if (ret->lhs == NULL)
         return value_newNull();
-    if (ret->numChildren == 3)
-        return execExpr(ctx, ret->children[1]);
-
-    criticalError("return: Expected 2 or 3 children.");
-    return NULL;
+    return execOperand(ctx, ret->lhs);
 }
 
 ExecValue *execBlock(Context* ctx, ASTNode *block)
 {
-    if (block->type != SYM_BLOCK)
-        criticalError("block: Invalid symbol type, expected SYM_BLOCK");
-    
-	for (int i = 0; i < block->numChildren; i++){
+    PARANOID_EXPECT(block, SYM_BLOCK);
+	for (size_t i = 0; i < block->numChildren; i++){
         ExecValue *result = execLine(ctx, block->children[i]);
         if (result->type == TYPE_ERROR)
             return result;
@@ -720,207 +667,144 @@ ExecValue *execBlock(Context* ctx, ASTNode *block)
 	return value_newNull();
 }
 
-ExecValue *execElse(Context* ctx, ASTNode *elseStmt){
-    if (elseStmt->type != SYM_ELSE)
-        criticalError("elsestmt: Invalid symbol type, expected SYM_ELSE");
-    
-	if (elseStmt->numChildren == 3)
-		return execBlock(ctx, elseStmt->children[2]);
-	else
-		criticalError("execElse: Invalid else.");
-
-    return value_newNull();
+ExecValue *execElse(Context* ctx, ASTNode *elseStmt)
+{
+    PARANOID_EXPECT(elseStmt, SYM_ELSE);
+    return execBlock(ctx, elseStmt->lhs);
 }
 
-ExecValue *execElseIf(Context* ctx, ASTNode *elseIfStmt){
-    if (elseIfStmt->type != SYM_ELSEIF)
-        criticalError("elseifstmt: Invalid symbol type, expected SYM_ELSEIF");
-
-    ExecValue *expr = execExpr(ctx, elseIfStmt->children[2]);
-    expr = unpackValue(ctx, expr);
+ExecValue *execElseIf(Context* ctx, ASTNode *elseIfStmt)
+{
+    PARANOID_EXPECT(elseIfStmt, SYM_ELSEIF);
+    ExecValue *expr = execOperand(ctx, elseIfStmt->lhs);
     if (expr->type == TYPE_ERROR)
         return expr;
-    if (value_falsiness(expr) == 1) { // true branch
-        return execBlock(ctx, elseIfStmt->children[5]);
-    } else {
-        if (elseIfStmt->numChildren == 7) {
-            if (elseIfStmt->children[6]->type == SYM_ELSEIF)
-                return execElseIf(ctx, elseIfStmt->children[6]);
-            else if (elseIfStmt->children[6]->type == SYM_ELSE)
-                return execElse(ctx, elseIfStmt->children[6]);
-
-            criticalError("execElseIf: Invalid branch -- not else if, or else");
-        }
-    }
+    int truth = value_falsiness(expr);
+    value_free(expr);
+
+    if (truth == 1) // true branch
+        return execBlock(ctx, elseIfStmt->rhs);
+    if (elseIfStmt->numChildren == 7)
+        return elseIfStmt->children[6]->eval(ctx, elseIfStmt->children[6]);
     return value_newNull();
 }
 
 ExecValue *execIfStmt(Context* ctx, ASTNode *ifStmt)
 {
-    if (ifStmt->type != SYM_IFSTMT)
-        criticalError("ifstmt: Invalid symbol type, expected SYM_IFSTMT");
-
-    ExecValue *expr = execExpr(ctx, ifStmt->children[1]);
-    expr = unpackValue(ctx, expr);
+    PARANOID_EXPECT(ifStmt, SYM_IFSTMT);
+    ExecValue *expr = execOperand(ctx, ifStmt->lhs);
     if (expr->type == TYPE_ERROR)
         return expr;
-    if (value_falsiness(expr) == 1) { // true branch
-        value_free(expr);
-        return execBlock(ctx, ifStmt->children[4]);
-    } else {
-        value_free(expr);
-        if (ifStmt->children[5]->type == SYM_ELSEIF)
-            return execElseIf(ctx, ifStmt->children[5]);
-        else if (ifStmt->children[5]->type == SYM_ELSE)
-            return execElse(ctx, ifStmt->children[5]);
-    }
+    int truth = value_falsiness(expr);
+    value_free(expr);
+
+    if (truth == 1) // true branch
+        return execBlock(ctx, ifStmt->rhs);
+    ASTNode *branch = ifStmt->children[5];
+    if (branch->type == SYM_ELSEIF || branch->type == SYM_ELSE)
+        return branch->eval(ctx, branch);
     return value_newNull();
 }
 
 ExecValue *execWhileStmt(Context* ctx, ASTNode *whileStmt)
 {
-    if (whileStmt->type != SYM_WHILE)
-        criticalError("ifstmt: Invalid symbol type, expected SYM_WHILE");
-    ExecValue *expr = execExpr(ctx, whileStmt->children[1]);
-    expr = unpackValue(ctx, expr);
-    if (expr->type == TYPE_ERROR)
+    PARANOID_EXPECT(whileStmt, SYM_WHILE);
+    size_t outerRun = hoist_enter(whileStmt);
+    ExecValue *retVal = NULL;
+    ExecValue *expr = execOperand(ctx, whileStmt->lhs);
+    if (expr->type == TYPE_ERROR) {
+        hoist_exit(whileStmt, outerRun);
         return expr;
+    }
     while (value_falsiness(expr) == 1){
-        ExecValue *blockErr = execBlock(ctx, whileStmt->children[3]);
+        ExecValue *blockErr = execBlock(ctx, whileStmt->rhs);
         if (blockErr->type == TYPE_ERROR) {
-            value_free(expr);
-            return blockErr;
+            retVal = blockErr;
+            break;
         }
         value_free(expr);
-        expr = execExpr(ctx, whileStmt->children[1]);
-        expr = unpackValue(ctx, expr);
+        expr = execOperand(ctx, whileStmt->lhs);
         if (expr->type == TYPE_ERROR) {
             value_free(blockErr);
-            return expr;
+            retVal = expr;
+            expr = NULL;
+            break;
         }
         if (ctx->hasBreakOrContinue == 1){
             ctx->hasBreakOrContinue = 0;
+            value_free(blockErr);
             break;
         } else if (ctx->hasBreakOrContinue == 2)
             ctx->hasBreakOrContinue = 0;
 
         value_free(blockErr);
     }
-    value_free(expr);
-    return value_newNull();
+    if (expr != NULL)
+        value_free(expr);
+    hoist_exit(whileStmt, outerRun);
+    return retVal != NULL ? retVal : value_newNull();
 }
 
 ExecValue *execBreak(Context* ctx, ASTNode *breakStmt)
 {
-    if (breakStmt->type != SYM_BREAK)
-        criticalError("ifstmt: Invalid symbol type, expected SYM_BREAK");
+    PARANOID_EXPECT(breakStmt, SYM_BREAK);
     ctx->hasBreakOrContinue = 1;
     return value_newNull();
 }
 
-ExecValue *execContinue(Context* ctx, ASTNode *breakStmt)
+ExecValue *execContinue(Context* ctx, ASTNode *continueStmt)
 {
-    if (breakStmt->type != SYM_CONTINUE)
-        criticalError("ifstmt: Invalid symbol type, expected SYM_CONTINUE");
+    PARANOID_EXPECT(continueStmt, SYM_CONTINUE);
     ctx->hasBreakOrContinue = 2;
     return value_newNull();
 }
 
-ExecValue *execStmt(Context* ctx, ASTNode *stmt)
+ExecValue *execAsmt(Context* ctx, ASTNode *asmt)
 {
-    if (stmt->type != SYM_STMT)
-        criticalError("stmt: Invalid symbol type, expected SYM_STMT");
-    if (ctx->hasBreakOrContinue)
-        return value_newNull();
-	if (stmt->numChildren == 1) {
-		if (stmt->children[0]->type == SYM_EXPR_STMT)
-			return execExprStmt(ctx, stmt->children[0]);
-		if (stmt->children[0]->type == SYM_PRNT_STMT)
-			return execPrntStmt(ctx, stmt->children[0]);
-		if (stmt->children[0]->type == SYM_IFSTMT)
-			return execIfStmt(ctx, stmt->children[0]);
-		if (stmt->children[0]->type == SYM_BREAK)
-			return execBreak(ctx, stmt->children[0]);
-        if (stmt->children[0]->type == SYM_CONTINUE)
-			return execContinue(ctx, stmt->children[0]);
-		if (stmt->children[0]->type == SYM_WHILE)
-			return execWhileStmt(ctx, stmt->children[0]);
-		if (stmt->children[0]->type == SYM_RETURN)
-			return execReturn(ctx, stmt->children[0]);
-		
-    }
-    criticalError("stmt: Invalid statement.");
-    return NULL;
+    PARANOID_EXPECT(asmt, SYM_ASMT);
+    ExecValue *rvalue = execOperand(ctx, asmt->rhs);
+    if (rvalue->type == TYPE_ERROR)
+        return rvalue;
+
+    // There's no explicit declaration in Miniscript, so we check the symbol table -- if it isn't there, we declare it
+    ExecValue lvalue = {TYPE_IDENTIFIER, .value.identifier_name = asmt->lhs->tok->lexeme};
+    ExecSymbol *sym = context_getSymbol(ctx, &lvalue);
+    if (sym == NULL)
+        context_addSymbol(ctx, &lvalue);
+
+    context_setSymbol(ctx, &lvalue, rvalue);
+    value_free(rvalue);
+    return value_newNull();
 }
 
-ExecValue *execAsmt(Context* ctx, ASTNode *asmt)
+ExecValue *execFusedAsmt(Context* ctx, ASTNode *asmt)
 {
-    if (asmt->type != SYM_ASMT)
-        criticalError("asmt: Invalid symbol type, expected SYM_ASMT");
-    if (ctx->hasBreakOrContinue)
-        return value_newNull();
-    if (asmt->numChildren == 4 &&
-        asmt->children[0]->tok->type == TOKEN_IDENTIFIER &&
-        asmt->children[1]->tok->type == TOKEN_EQUAL &&
-        asmt->children[2]->type == SYM_EXPR &&
-        asmt->children[3]->tok->type == TOKEN_NL) {
-        ExecValue *lvalue = execTerminal(ctx, asmt->children[0]);
-        ExecValue *rvalue = execExpr(ctx, asmt->children[2]);
-        rvalue = unpackValue(ctx, rvalue);
-
-        if (lvalue->type == TYPE_ERROR) {
-            value_free(rvalue);
-            return lvalue;
-        } else if (rvalue->type == TYPE_ERROR) {
-            value_free(lvalue);
-            return rvalue;
-        }
-        
-        // There's no explicit declaration in Miniscript, so we check the symbol table -- if it isn't there, we declare it
-        ExecSymbol *sym = context_getSymbol(ctx, lvalue);
-        if (sym == NULL)
-            context_addSymbol(ctx, lvalue);
-
-        context_setSymbol(ctx, lvalue, rvalue);
-        value_free(lvalue); value_free(rvalue);
+    PARANOID_EXPECT(asmt, SYM_ASMT);
+    if (fusion_asmt(ctx, asmt))
         return value_newNull();
-    }
-    criticalError("asmt: Invalid assignment.");
-    return NULL;
+    relink(asmt, execAsmt);
+    return execAsmt(ctx, asmt);
 }
 
 ExecValue *execLine(Context* ctx, ASTNode *line)
 {
-    if (line->type != SYM_LINE)
-        criticalError("line: Invalid symbol type, expected SYM_LINE");
+    PARANOID_EXPECT(line, SYM_LINE);
     if (ctx->hasBreakOrContinue)
         return value_newNull();
-    if (line->numChildren == 1) {
-        if (line->children[0]->type == SYM_ASMT)
-            return execAsmt(ctx, line->children[0]);
-        if (line->children[0]->type == SYM_STMT)
-            return execStmt(ctx, line->children[0]);
-        criticalError("line: Line has invalid children.");
-    }
-    criticalError("line: Expected line to have 1 child.");
-    return NULL;
+    return line->lhs->eval(ctx, line->lhs);
 }
 
 ExecValue *execStart(Context* ctx, ASTNode *start)
 {
+    PARANOID_EXPECT(start, SYM_START);
     // Returns the execution exit code
     //TODO: all runtime errors here
-    int exitCode = 0;
     for (size_t i = 0; i < start->numChildren; i++) {
         ASTNode *child = start->children[i];
-        ExecValue *result;
-        if (child->type == SYM_LINE)
-            result = execLine(ctx, child);
-        else if (child->tok->type == TOKEN_EOF)
+        if (child->type != SYM_LINE)
             break;
-        else
-            criticalError("Unexpected symbol.");
 
+        ExecValue *result = execLine(ctx, child);
         if (result->type == TYPE_ERROR)
             return result;
 
@@ -929,3 +813,195 @@ ExecValue *execStart(Context* ctx, ASTNode *start)
 
     return value_newNull();
 }
+
+// Returns the node that does the work for `node`, skipping the nodes that only pass on their single child.
+ASTNode *lowerResolve(ASTNode *node)
+{
+    while (1) {
+        switch (node->type) {
+        case SYM_LINE: case SYM_STMT: case SYM_EXPR:
+        case SYM_OR_EXPR: case SYM_AND_EXPR: case SYM_LOG_UNARY:
+        case SYM_EQUALITY: case SYM_COMPARISON: case SYM_SUM: case SYM_TERM:
+        case SYM_UNARY: case SYM_POWER:
+            if (node->numChildren != 1)
+                return node;
+            node = node->children[0];
+            break;
+        case SYM_PRIMARY:
+            node = node->children[node->numChildren == 3 ? 1 : 0];
+            break;
+        default:
+            return node;
+        }
+    }
+}
+
+void lowerBinary(ASTNode *node)
+{
+    if (node->numChildren == 1) {
+        node->lhs = lowerResolve(node);
+        node->eval = execForward;
+        return;
+    }
+
+    node->op = node->children[1]->tok->type;
+    node->lhs = lowerResolve(node->children[0]);
+    node->rhs = lowerResolve(node->children[2]);
+    if (node->fused == FUSE_COMPARE)
+        node->eval = execFusedCompare;
+    else if (node->fused == FUSE_MOD_EQ)
+        node->eval = execFusedModEq;
+    else if (node->quick > QUICK_GENERIC)
+        node->eval = execQuickBinary;
+    else
+        node->eval = execBinary;
+}
+
+void lowerUnary(ASTNode *node)
+{
+    if (node->numChildren == 1) {
+        node->lhs = lowerResolve(node);
+        node->eval = execForward;
+        return;
+    }
+
+    node->op = node->children[0]->tok->type;
+    node->rhs = lowerResolve(node->children[1]);
+    node->eval = execUnary;
+}
+
+void lowerNode(ASTNode *node)
+{
+    for (size_t i = 0; i < node->numChildren; i++)
+        lowerNode(node->children[i]);
+
+    node->eval = NULL;
+    node->lhs = NULL;
+    node->rhs = NULL;
+
+    switch (node->type) {
+    case SYM_START:
+        node->eval = execStart;
+        break;
+    case SYM_LINE:
+        node->lhs = lowerResolve(node->children[0]);
+        node->eval = execLine;
+        break;
+    case SYM_STMT:
+    case SYM_EXPR:
+    case SYM_PRIMARY:
+        node->lhs = lowerResolve(node);
+        node->eval = execForward;
+        break;
+    case SYM_ASMT:
+        node->lhs = node->children[0];
+        node->rhs = lowerResolve(node->children[2]);
+        node->eval = node->fused == FUSE_LOCAL_ARITH ? execFusedAsmt : execAsmt;
+        break;
+    case SYM_EXPR_STMT:
+        node->lhs = lowerResolve(node->children[0]);
+        node->eval = execExprStmt;
+        break;
+    case SYM_PRNT_STMT:
+        if (node->numChildren == 3)
+            node->lhs = lowerResolve(node->children[1]);
+        node->eval = execPrntStmt;
+        break;
+    case SYM_IFSTMT:
+        node->lhs = lowerResolve(node->children[1]);
+        node->rhs = node->children[4];
+        node->eval = execIfStmt;
+        break;
+    case SYM_ELSEIF:
+        node->lhs = lowerResolve(node->children[2]);
+        node->rhs = node->children[5];
+        node->eval = execElseIf;
+        break;
+    case SYM_ELSE:
+        node->lhs = node->children[2];
+        node->eval = execElse;
+        break;
+    case SYM_BLOCK:
+        node->eval = execBlock;
+        break;
+    case SYM_WHILE:
+        node->lhs = lowerResolve(node->children[1]);
+        node->rhs = node->children[3];
+        node->eval = execWhileStmt;
+        break;
+    case SYM_BREAK:
+        node->eval = execBreak;
+        break;
+    case SYM_CONTINUE:
+        node->eval = execContinue;
+        break;
+    case SYM_RETURN:
+        if (node->numChildren == 3)
+            node->lhs = lowerResolve(node->children[1]);
+        node->eval = execReturn;
+        break;
+    case SYM_FN_EXPR:
+        node->lhs = node->children[2];
+        node->rhs = node->children[5];
+        node->eval = execFnExpr;
+        break;
+    case SYM_ARG_LIST:
+        node->eval = execArgList;
+        break;
+    case SYM_ARG:
+        node->lhs = node->children[0];
+        if (node->numChildren == 3)
+            node->rhs = node->children[2];
+        node->eval = execArg;
+        break;
+    case SYM_OR_EXPR: case SYM_AND_EXPR: case SYM_EQUALITY: case SYM_COMPARISON:
+    case SYM_SUM: case SYM_TERM: case SYM_POWER:
+        lowerBinary(node);
+        break;
+    case SYM_LOG_UNARY: case SYM_UNARY:
+        lowerUnary(node);
+        break;
+    case SYM_FN_CALL:
+        node->lhs = node->children[0];
+        node->rhs = node->children[2];
+        if (profile_enabled())
+            node->eval = execProfiledFnCall;
+        else
+            node->eval = trace_enabled() ? execTracedFnCall : execFnCall;
+        break;
+    case SYM_FN_ARGS:
+        node->eval = execFnArgs;
+        break;
+    case SYM_TERMINAL:
+        // Only terminals that are values get an evaluator
+        node->op = node->tok->type;
+        switch (node->tok->type) {
+        case TOKEN_NULL:       node->eval = execNull; break;
+        case TOKEN_TRUE:       node->eval = execTrue; break;
+        case TOKEN_FALSE:      node->eval = execFalse; break;
+        case TOKEN_NUMBER:     node->eval = execNumber; break;
+        case TOKEN_STRING:     node->eval = execString; break;
+        case TOKEN_IDENTIFIER: node->eval = execIdentifier; break;
+        default: break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void execLower(ASTNode *node)
+{
+#ifdef MS_PARANOID
+    const char *reason;
+    ASTNode *invalid = astnode_verify(node, &reason);
+    if (invalid != NULL) {
+        char msg[MAX_ERRMSG_LEN];
+        snprintf(msg, MAX_ERRMSG_LEN, "lower: %s %s\n", SymbolTypeString[invalid->type], reason);
+        criticalError(msg);
+    }
+#endif
+    lowerNode(node);
+    typeinfer_analyze(node);
+    hoist_analyze(node);
+}
@@ -5,13 +5,25 @@
 #include "symboltable.h"
 
 /**
-execSymbol:
-- Returns NULL, or the evaluated ExecValue*.
+execLower() checks the shape of a tree once, and links every node to the function that evaluates it:
+- node->eval is one of the exec* functions below.
+- node->lhs and node->rhs are the operands, skipping the nodes that only pass on their single child.
+- node->op is the operator token of a binary or unary node.
+Loop-invariant expressions are then hoisted, see hoist.h.
+
+exec*:
+- Takes a lowered node, and returns the evaluated ExecValue*. The node's shape is not checked again.
  */
 
+// Script function calls made, including the inlined and memoized ones.
+extern size_t fnCalls;
+
+// Lowers `node` and everything under it. Every tree has to be lowered before it's executed.
+void execLower(ASTNode *node);
+
 ExecValue* execStart(Context* ctx, ASTNode *start);
 ExecValue* execLine(Context* ctx, ASTNode *line);
-ExecValue* execStmt(Context* ctx, ASTNode *stmt);
+ExecValue* execForward(Context* ctx, ASTNode *node);
 ExecValue* execContinue(Context* ctx, ASTNode *stmt);
 ExecValue* execBreak(Context* ctx, ASTNode *stmt);
 ExecValue* execWhileStmt(Context* ctx, ASTNode *stmt);
@@ -22,22 +34,31 @@ ExecValue* execBlock(Context* ctx, ASTNode *stmt);
 ExecValue* execReturn(Context* ctx, ASTNode *stmt);
 ExecValue* execExprStmt(Context* ctx, ASTNode *exprStmt);
 ExecValue* execPrntStmt(Context* ctx, ASTNode *prntStmt);
-ExecValue* execExpr(Context* ctx, ASTNode* expr);
+ExecValue* execAsmt(Context* ctx, ASTNode *asmt);
+ExecValue* execFusedAsmt(Context* ctx, ASTNode *asmt);
 ExecValue* execFnExpr(Context* ctx, ASTNode* expr);
 ExecValue* execArgList(Context* ctx, ASTNode* expr);
 ExecValue* execArg(Context* ctx, ASTNode* expr);
-ExecValue* execOrExpr(Context* ctx, ASTNode* orExpr);
-ExecValue* execAndExpr(Context* ctx, ASTNode* andExpr);
-ExecValue* execLogUnary(Context* ctx, ASTNode* logUnary);
-ExecValue* execEquality(Context* ctx, ASTNode *equality);
-ExecValue* execComparison(Context* ctx, ASTNode *comparison);
-ExecValue* execSum(Context* ctx, ASTNode *sum);
-ExecValue* execTerm(Context* ctx, ASTNode *term);
+ExecValue* execBinary(Context* ctx, ASTNode *node);
+ExecValue* execQuickBinary(Context* ctx, ASTNode *node); // Binary node quickened to numbers, see quicken()
+ExecValue* execTypedNumber(Context* ctx, ASTNode *node); // Binary node with operands inferred to be numbers, see typeinfer.h
+ExecValue* execTypedConcat(Context* ctx, ASTNode *node); // String + string, inferred
+ExecValue* execFusedCompare(Context* ctx, ASTNode *comparison);
+ExecValue* execFusedModEq(Context* ctx, ASTNode *equality);
+ExecValue* execHoisted(Context* ctx, ASTNode *node); // Loop-invariant expression, see hoist.h
 ExecValue* execUnary(Context* ctx, ASTNode *unary);
-ExecValue* execPower(Context* ctx, ASTNode *power);
-ExecValue* execPrimary(Context* ctx, ASTNode *primary);
 ExecValue* execFnCall(Context* ctx, ASTNode *fnCall); // doesn't work in REPL mode -- the tokens, AST are discarded for the next run, which removes the function call
+ExecValue* execTracedFnCall(Context* ctx, ASTNode *fnCall); // Function call while tracing, see stats/trace.h
+ExecValue* execProfiledFnCall(Context* ctx, ASTNode *fnCall); // Function call while profiling, see stats/profile.h
 ExecValue* execFnArgs(Context* ctx, ASTNode *fnArgs);
-ExecValue* execTerminal(Context* ctx, ASTNode *terminal);
+ExecValue* execNull(Context* ctx, ASTNode *terminal);
+ExecValue* execTrue(Context* ctx, ASTNode *terminal);
+ExecValue* execFalse(Context* ctx, ASTNode *terminal);
+ExecValue* execNumber(Context* ctx, ASTNode *terminal);
+ExecValue* execString(Context* ctx, ASTNode *terminal);
+ExecValue* execIdentifier(Context* ctx, ASTNode *terminal);
+
+// Evaluates `node` and returns a NEW ExecValue with the value, looking up identifiers in `ctx` and then the global scope.
+ExecValue* execOperand(Context* ctx, ASTNode *node);
 
 #endif
@@ -1,135 +1,211 @@
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 #include "../logger/logger.h"
+#include "../memory/allocator.h"
 #include "execvalue.h"
+#include "stringref.h"
+#include "memo.h"
+#include "numeric.h"
+
+Pool valuePool = POOL_INIT("ExecValue", ExecValue);
+Pool functionPool = POOL_INIT("FunctionRef", FunctionRef);
+
+// Returns a NEW ExecValue with a single reference, for the value_new* functions to fill in.
+ExecValue *_value_alloc()
+{
+    ExecValue *val = pool_alloc(&valuePool);
+    val->refCount = 1;
+    return val;
+}
 
 ExecValue *value_newNull()
 {
-    ExecValue *val = malloc(sizeof(ExecValue));
+    ExecValue *val = _value_alloc();
     val->type = TYPE_NULL;
     val->value.literal_null = NULL;
-    val->tok = token_new(TOKEN_NULL, "null", 4, -1, -1);
     return val;
 }
 
-ExecValue *value_newString(char *strValue, Token *tokPtr)
+ExecValue *value_newString(char *strValue)
 {
-    ExecValue *val = malloc(sizeof(ExecValue));
+    ExecValue *val = _value_alloc();
     val->type = TYPE_STRING;
 
-    // Create null-terminated copy of the string
-    char *str_cpy = strdup(strValue);
-    val->value.literal_str = str_cpy;
-    val->tok = tokPtr;
+    val->value.string_ref = stringref_new(strValue, strlen(strValue));
     return val;
 }
 
-ExecValue *value_newNumber(double numValue, Token *tokPtr)
+ExecValue *value_newStringRef(StringRef *ref)
 {
-    ExecValue *val = malloc(sizeof(ExecValue));
+    ExecValue *val = _value_alloc();
+    val->type = TYPE_STRING;
+    val->value.string_ref = ref;
+    return val;
+}
+
+char *value_str(ExecValue *val)
+{
+    return stringref_chars(val->value.string_ref);
+}
+
+ExecValue *value_newNumber(double numValue)
+{
+    ExecValue *val = _value_alloc();
     val->type = TYPE_NUMBER;
-    val->value.literal_num = numValue;
-    val->tok = tokPtr;
+    value_setNumber(val, numValue);
     return val;
 }
 
-ExecValue *value_newIdentifier(char *identifierName, Token *tokPtr)
+void value_setNumber(ExecValue *val, double num)
+{
+    val->isInt = value_isIntegral(num);
+    if (val->isInt)
+        val->value.literal_int = (int64_t) num;
+    else
+        val->value.literal_num = num;
+}
+
+ExecValue *value_newInt(int64_t numValue)
 {
-    ExecValue *val = malloc(sizeof(ExecValue));
+    if (numValue < -VALUE_INT_MAX || numValue > VALUE_INT_MAX)
+        return value_newNumber((double) numValue);
+    ExecValue *val = _value_alloc();
+    val->type = TYPE_NUMBER;
+    val->isInt = 1;
+    val->value.literal_int = numValue;
+    return val;
+}
+
+ExecValue *value_newIdentifier(char *identifierName)
+{
+    ExecValue *val = _value_alloc();
     val->type = TYPE_IDENTIFIER;
 
     // Create null-terminated copy of the identifier name
-    char *name_cpy = strdup(identifierName);
+    char *name_cpy = mem_strdup(identifierName);
     val->value.identifier_name = name_cpy;
-    val->tok = tokPtr;
     return val;
 }
 
-ExecValue *value_newError(Error *err, Token *tokPtr)
+ExecValue *value_newError(Error *err)
 {
-    ExecValue *val = malloc(sizeof(ExecValue));
+    ExecValue *val = _value_alloc();
     val->type = TYPE_ERROR;
+    val->rightOperand = 0;
     val->value.error_ptr = err;
-    val->tok = tokPtr;
-    if (val->tok != NULL) {
-        err->lineNum = val->tok->lineNum;
-        err->colNum = val->tok->colNum;
-    } else {
-        err->lineNum = -1;
-        err->colNum = -1;
+    return val;
+}
+
+// Returns a NEW error value about the right operand of a binary operator if `rightOperand`, or the left one otherwise.
+ExecValue *_value_operandError(Error *err, int rightOperand)
+{
+    ExecValue *val = value_newError(err);
+    val->rightOperand = rightOperand;
+    return val;
+}
+
+ExecValue *value_locate(ExecValue *val, Token *tok)
+{
+    if (val->type == TYPE_ERROR && val->value.error_ptr->lineNum == -1 && tok != NULL) {
+        // The token is in the code being run, which can be the body of a function from an earlier run. The error
+        // keeps its source, as the function can be gone by the time the error is reported.
+        Error *err = val->value.error_ptr;
+        err->ctx = error_retainContext(errorContext);
+        err->holdsCtx = 1;
+        err->lineNum = tok->lineNum;
+        err->colNum = tok->colNum;
     }
     return val;
 }
 
-ExecValue *value_newFunction(ASTNode *argList, ASTNode *block, Token *tokPtr)
+ExecValue *value_newFunction(ASTNode *argList, ASTNode *block)
 {
-    ExecValue *val = malloc(sizeof(ExecValue));
-    FunctionRef* fnRef = malloc(sizeof(FunctionRef));
+    ExecValue *val = _value_alloc();
+    FunctionRef* fnRef = pool_alloc(&functionPool);
     fnRef->argList = astnode_clone(argList);
     fnRef->fnBlk = astnode_clone(block);
+    fnRef->refCount = 1;
+    fnRef->errorCtx = error_retainContext(errorContext);
+    fnRef->memo = memo_new();
+    fnRef->callCount = 0;
+    fnRef->numeric = NULL;
+    fnRef->inlineExpr = NULL;
+    fnRef->inlineEpoch = SIZE_MAX;
     val->type = TYPE_FUNCTION;
     val->value.function_ref = fnRef;
-    val->tok = tokPtr;
     return val;
 }
 
 ExecValue *value_clone(ExecValue *value)
 {
+    value->refCount++;
+    return value;
+}
+
+ExecValue *value_own(ExecValue *value)
+{
+    if (value->refCount == 1)
+        return value;
+
+    ExecValue *copy = _value_alloc();
+    copy->type = value->type;
+    copy->isInt = value->isInt;
+    copy->value = value->value;
     switch (value->type) {
-    case TYPE_STRING: return value_newString(value->value.literal_str, value->tok);
-    case TYPE_NUMBER: return value_newNumber(value->value.literal_num, value->tok);
-    case TYPE_NULL: return value_newNull();
-    case TYPE_IDENTIFIER: return value_newIdentifier(value->value.identifier_name, value->tok);
-    case TYPE_FUNCTION: {
-        ASTNode *argList = value->value.function_ref->argList;
-        ASTNode *block   = value->value.function_ref->fnBlk;
-        return value_newFunction(argList, block, value->tok);
-    }
-    case TYPE_ERROR: return value_newError(value->value.error_ptr, value->tok);
-    default:
-        log_message(&executionLogger, "Critical Error: value_clone: Unknown ValueType %d.\n", value->type);
-        exit(1);
+    case TYPE_STRING: stringref_retain(value->value.string_ref); break;
+    case TYPE_IDENTIFIER: copy->value.identifier_name = mem_strdup(value->value.identifier_name); break;
+    case TYPE_FUNCTION: value->value.function_ref->refCount++; break;
+    case TYPE_ERROR: criticalError("own: errors are never changed in place.");
+    default: break;
     }
-    return NULL;
+    value->refCount--;
+    return copy;
 }
 
 void value_free(ExecValue *value)
 {
+    if (--value->refCount > 0)
+        return;
     switch (value->type) {
-    case TYPE_STRING: free(value->value.literal_str); break;
-    case TYPE_IDENTIFIER: free(value->value.identifier_name); break;
+    case TYPE_STRING: stringref_release(value->value.string_ref); break;
+    case TYPE_IDENTIFIER: mem_free(value->value.identifier_name); break;
     case TYPE_ERROR: error_free(value->value.error_ptr); break;
     case TYPE_FUNCTION: {
         FunctionRef *ref = value->value.function_ref;
+        ref->refCount--;
+        if (ref->refCount > 0)
+            break;
         astnode_free(ref->argList);
         astnode_free(ref->fnBlk);
-        free(value->value.function_ref);
+        memo_free(ref->memo);
+        error_releaseContext(ref->errorCtx);
+        if (ref->numeric != NULL)
+            numeric_free(ref->numeric);
+        pool_free(&functionPool, ref);
         break;
     }
     default: break;
     }
-    free(value);
+    pool_free(&valuePool, value);
 }
 
 int value_falsiness(ExecValue *e)
 {
     switch (e->type) {
     case TYPE_NULL: return 0; // NULL is FALSE
-    case TYPE_NUMBER: return (e->value.literal_num != 0);  // any number other than 0 is TRUE
-    case TYPE_STRING: return (strlen(e->value.literal_str) != 0); // any string other than "" is TRUE
+    case TYPE_NUMBER: return (value_toDouble(e) != 0);  // any number other than 0 is TRUE
+    case TYPE_STRING: return (e->value.string_ref->length != 0); // any string other than "" is TRUE
     case TYPE_ERROR:
         criticalError("value_falsiness: Tried to get the falsiness of an error.");
         exit(1);
     case TYPE_IDENTIFIER:
         criticalError("value_falsiness: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
         exit(1);
-    case TYPE_FUNCTION: {
-        Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-        snprintf(typeErr->message, MAX_ERRMSG_LEN, "tried to get the falsiness of a function.");
+    case TYPE_FUNCTION:
         return -1;
-    }
     case TYPE_UNASSIGNED:
         criticalError("value_falsiness: passed an unassigned value..");
         exit(1);
@@ -142,15 +218,13 @@ ExecValue* value_opUnaryPos(ExecValue *e)
     if (e == NULL)
         criticalError("pos: e1 or e2 is null");
     if (e->type == TYPE_NULL || e->type == TYPE_STRING) {
-        Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-        snprintf(typeErr->message, MAX_ERRMSG_LEN, "unary positive expects a number, instead got %s", ValueTypeString[e->type]);
-        return value_newError(typeErr, e->tok);
+        Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_POS_TYPE, -1, -1);
+        return value_newError(error_withArgs(typeErr, ValueTypeString[e->type], NULL));
     }
     if (e->type == TYPE_IDENTIFIER)
         criticalError("pos: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
-    double result = e->value.literal_num;
-    return value_newNumber(result, e->tok);
+    return value_clone(e);
 }
 
 ExecValue* value_opUnaryNeg(ExecValue *e)
@@ -158,15 +232,15 @@ ExecValue* value_opUnaryNeg(ExecValue *e)
     if (e == NULL)
         criticalError("neg: e1 or e2 is null");
     if (e->type == TYPE_NULL || e->type == TYPE_STRING) {
-        Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-        snprintf(typeErr->message, MAX_ERRMSG_LEN, "unary negative expects a number, instead got %s", ValueTypeString[e->type]);
-        return value_newError(typeErr, e->tok);
+        Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_NEG_TYPE, -1, -1);
+        return value_newError(error_withArgs(typeErr, ValueTypeString[e->type], NULL));
     }
     if (e->type == TYPE_IDENTIFIER)
         criticalError("neg: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
-    double result = -e->value.literal_num;
-    return value_newNumber(result, e->tok);
+    // -0 is a double
+    double result = -value_toDouble(e);
+    return value_newNumber(result);
 }
 
 ExecValue* value_opNot(ExecValue *e)
@@ -175,7 +249,7 @@ ExecValue* value_opNot(ExecValue *e)
         criticalError("not: e is null");
 
     double result = !value_falsiness(e);
-    return value_newNumber(result, e->tok);
+    return value_newNumber(result);
 }
 
 ExecValue* value_opOr(ExecValue *e1, ExecValue *e2)
@@ -184,7 +258,7 @@ ExecValue* value_opOr(ExecValue *e1, ExecValue *e2)
         criticalError("or: e1 or e2 is null");
 
     double result = value_falsiness(e1) || value_falsiness(e2);
-    return value_newNumber(result, e1->tok);
+    return value_newNumber(result);
 }
 
 ExecValue* value_opAnd(ExecValue *e1, ExecValue *e2)
@@ -193,7 +267,15 @@ ExecValue* value_opAnd(ExecValue *e1, ExecValue *e2)
         criticalError("and: e1 or e2 is null");
 
     double result = value_falsiness(e1) && value_falsiness(e2);
-    return value_newNumber(result, e1->tok);
+    return value_newNumber(result);
+}
+
+// Returns a NEW StringRef with the number `num` as print shows it.
+StringRef *_value_numberString(ExecValue *num)
+{
+    char chars[32];
+    int length = snprintf(chars, sizeof(chars), "%g", value_toDouble(num));
+    return stringref_new(chars, length);
 }
 
 ExecValue* value_opAdd(ExecValue *e1, ExecValue *e2)
@@ -204,54 +286,34 @@ ExecValue* value_opAdd(ExecValue *e1, ExecValue *e2)
         criticalError("add: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num + e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        int64_t n;
+        if (e1->isInt && e2->isInt && value_intArith(TOKEN_PLUS, e1->value.literal_int, e2->value.literal_int, &n))
+            return value_newInt(n);
+        double result = value_toDouble(e1) + value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
-        char *s1 = e1->value.literal_str;
-        char *s2 = e2->value.literal_str;
-        size_t resultLen = strlen(s1) + strlen(s2);
-        char *result = malloc((resultLen + 1) * sizeof(char));
-        strncpy(result, s1, strlen(s1));
-        strncpy(result + strlen(s1), s2, strlen(s2));
-        result[resultLen] = '\0';
-        ExecValue *resultVal = value_newString(result, e1->tok);
-        free(result);
-        return resultVal;
+        return value_concat(e1, e2);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_NUMBER) {
-        char *s1 = e1->value.literal_str;
-        // get the length of the double
-        size_t s1Len = strlen(s1);
-        size_t s2Len = snprintf(NULL, 0, "%g", e2->value.literal_num);
-        size_t resultLen = s1Len + s2Len;
-        char *result = malloc((resultLen + 1) * sizeof(char));
-        strncpy(result, s1, s1Len);
-        snprintf(result + s1Len, s2Len + 1, "%g", e2->value.literal_num);
-        result[resultLen] = '\0';
-        ExecValue *resultVal = value_newString(result, e1->tok);
-        free(result);
+        StringRef *s2 = _value_numberString(e2);
+        ExecValue *resultVal = value_newStringRef(stringref_concat(e1->value.string_ref, s2));
+        stringref_release(s2);
         return resultVal;
     } else if (e1->type == TYPE_NUMBER && e2->type == TYPE_STRING) {
-        char *s2 = e2->value.literal_str;
-        // get the length of the double
-        size_t s2Len = strlen(s2);
-        size_t s1Len = snprintf(NULL, 0, "%g", e1->value.literal_num);
-        size_t resultLen = s1Len + s2Len;
-        char *result = malloc((resultLen + 1) * sizeof(char));
-        snprintf(result, s1Len + 1, "%g", e1->value.literal_num);
-        strncpy(result + s1Len, s2, s2Len);
-        result[resultLen] = '\0';
-        ExecValue *resultVal = value_newString(result, e1->tok);
-        free(result);
+        StringRef *s1 = _value_numberString(e1);
+        ExecValue *resultVal = value_newStringRef(stringref_concat(s1, e2->value.string_ref));
+        stringref_release(s1);
         return resultVal;
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "addition expects two strings or two numbers, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER || e1->type == TYPE_STRING)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_ADD_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER || e1->type == TYPE_STRING);
+}
+
+ExecValue* value_concat(ExecValue *e1, ExecValue *e2)
+{
+    return value_newStringRef(stringref_concat(e1->value.string_ref, e2->value.string_ref));
 }
 
 ExecValue* value_opSub(ExecValue *e1, ExecValue *e2)
@@ -262,17 +324,20 @@ ExecValue* value_opSub(ExecValue *e1, ExecValue *e2)
         criticalError("sub: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num - e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        int64_t n;
+        if (e1->isInt && e2->isInt && value_intArith(TOKEN_MINUS, e1->value.literal_int, e2->value.literal_int, &n))
+            return value_newInt(n);
+        double result = value_toDouble(e1) - value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
         // Delete s2 from the end of s1, assuming s2 is an exact match of the end of s1
-        char *s1 = e1->value.literal_str;
-        char *s2 = e2->value.literal_str;
-        size_t s1Len = strlen(s1);
-        size_t s2Len = strlen(s2);
+        char *s1 = value_str(e1);
+        char *s2 = value_str(e2);
+        size_t s1Len = e1->value.string_ref->length;
+        size_t s2Len = e2->value.string_ref->length;
         if (s1Len < s2Len) {
             // Impossible for s2 to be an exact match of s1
-            return value_newString(s1, e1->tok);
+            return value_clone(e1);
         }
         
         int matching = 0; // true if we're in the matching state
@@ -296,25 +361,34 @@ ExecValue* value_opSub(ExecValue *e1, ExecValue *e2)
         }
 
         if (!match)
-            return value_newString(s1, e1->tok);
+            return value_clone(e1);
 
         // Exact match: can safely just copy exactly resultLen characters starting from s1
         size_t resultLen = s1Len - s2Len;
-        char *resultString = malloc(sizeof(char) * (resultLen + 1));
-        strncpy(resultString, s1, resultLen);
-        resultString[resultLen] = '\0';
-        ExecValue *resultVal = value_newString(resultString, e1->tok);
-        free(resultString);
-        return resultVal;
+        return value_newStringRef(stringref_new(s1, resultLen));
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "subtraction expects two numbers or two strings, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_SUB_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER);
+}
+
+// Returns a NEW StringRef with the characters of the string `str` repeated, up to `resultLen` characters.
+StringRef *_value_repeat(ExecValue *str, size_t resultLen)
+{
+    char *chars = value_str(str);
+    size_t origLen = str->value.string_ref->length;
+    // Short results are built on the stack, they're kept inline in their StringRef
+    char inlineChars[STRING_INLINE_LENGTH + 1];
+    char *newStr = resultLen <= STRING_INLINE_LENGTH ? inlineChars : mem_allocBase((resultLen + 1) * sizeof(char));
+    // Start copying the str into newStr until we reach the end of string
+    for (size_t i = 0; i < resultLen; i++)
+        newStr[i] = *(chars + (i % origLen));
+    newStr[resultLen] = '\0';
+    if (newStr == inlineChars)
+        return stringref_new(newStr, resultLen);
+    return stringref_take(newStr, resultLen);
 }
 
 ExecValue* value_opMul(ExecValue *e1, ExecValue *e2)
@@ -325,33 +399,24 @@ ExecValue* value_opMul(ExecValue *e1, ExecValue *e2)
         criticalError("mul: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num * e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        int64_t n;
+        if (e1->isInt && e2->isInt && value_intArith(TOKEN_STAR, e1->value.literal_int, e2->value.literal_int, &n))
+            return value_newInt(n);
+        double result = value_toDouble(e1) * value_toDouble(e2);
+        return value_newNumber(result);
     }
     if (e1->type == TYPE_STRING && e2->type == TYPE_NUMBER) {
-        double multiplier = e2->value.literal_num;
+        double multiplier = value_toDouble(e2);
         if (multiplier < 0)
             multiplier = 0;
-        char *str = e1->value.literal_str;
-        size_t origLen = strlen(str);
-        size_t resultLen = (size_t) ((double) origLen * multiplier);
-        char *newStr = malloc((resultLen + 1) * sizeof(char));
-        // Start copying the str into newStr until we reach the end of string
-        for (size_t i = 0; i < resultLen; i++)
-            newStr[i] = *(str + (i % origLen));
-        newStr[resultLen] = '\0';
-        ExecValue *resultVal = value_newString(newStr, e1->tok);
-        free(newStr);
-        return resultVal;
+        size_t resultLen = (size_t) ((double) e1->value.string_ref->length * multiplier);
+        return value_newStringRef(_value_repeat(e1, resultLen));
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "multiplication expects two numbers or a string and a number, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_MUL_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER);
 }
 
 ExecValue* value_opDiv(ExecValue *e1, ExecValue *e2)
@@ -362,33 +427,21 @@ ExecValue* value_opDiv(ExecValue *e1, ExecValue *e2)
         criticalError("div: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num / e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        double result = value_toDouble(e1) / value_toDouble(e2);
+        return value_newNumber(result);
     }
     if (e1->type == TYPE_STRING && e2->type == TYPE_NUMBER) {
-        double multiplier = e2->value.literal_num;
+        double multiplier = value_toDouble(e2);
         if (multiplier < 0)
             multiplier = 0;
-        char *str = e1->value.literal_str;
-        size_t origLen = strlen(str);
-        size_t resultLen = (size_t) ((double) origLen / multiplier);
-        char *newStr = malloc((resultLen + 1) * sizeof(char));
-        // Start copying the str into newStr until we reach the end of string
-        for (size_t i = 0; i < resultLen; i++)
-            newStr[i] = *(str + (i % origLen));
-        newStr[resultLen] = '\0';
-        ExecValue *resultVal = value_newString(newStr, e1->tok);
-        free(newStr);
-        return resultVal;
+        size_t resultLen = (size_t) ((double) e1->value.string_ref->length / multiplier);
+        return value_newStringRef(_value_repeat(e1, resultLen));
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "division expects two numbers or a string and a number, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_DIV_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER);
 }
 
 ExecValue* value_opMod(ExecValue *e1, ExecValue *e2)
@@ -399,17 +452,17 @@ ExecValue* value_opMod(ExecValue *e1, ExecValue *e2)
         criticalError("mod: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = fmod(e1->value.literal_num, e2->value.literal_num);
-        return value_newNumber(result, e1->tok);
+        int64_t n;
+        if (e1->isInt && e2->isInt && value_intArith(TOKEN_PERCENT, e1->value.literal_int, e2->value.literal_int, &n))
+            return value_newInt(n);
+        double result = fmod(value_toDouble(e1), value_toDouble(e2));
+        return value_newNumber(result);
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "modulo expects two numbers, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_MOD_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER);
 }
 
 ExecValue* value_opPow(ExecValue *e1, ExecValue *e2)
@@ -420,17 +473,14 @@ ExecValue* value_opPow(ExecValue *e1, ExecValue *e2)
         criticalError("pow: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = pow(e1->value.literal_num, e2->value.literal_num);
-        return value_newNumber(result, e1->tok);
+        double result = pow(value_toDouble(e1), value_toDouble(e2));
+        return value_newNumber(result);
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "power expects two numbers, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_POW_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER);
 }
 
 ExecValue* value_opEqEq(ExecValue *e1, ExecValue *e2)
@@ -441,24 +491,17 @@ ExecValue* value_opEqEq(ExecValue *e1, ExecValue *e2)
         criticalError("eq: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num == e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        double result = value_toDouble(e1) == value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
-        char *s1 = e1->value.literal_str;
-        char *s2 = e2->value.literal_str;
-        double result = 1;
-
-        if (strlen(s1) != strlen(s2))
-            result = 0;
-        else
-            result = (strncmp(s1, s2, strlen(s1)) == 0) ? 1 : 0;
-        return value_newNumber(result, e1->tok);
+        double result = stringref_equal(e1->value.string_ref, e2->value.string_ref);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_NULL && e2->type == TYPE_NULL) {
-        return value_newNumber(1, e1->tok);
+        return value_newNumber(1);
     }
     
     // different types, so not equal
-    return value_newNumber(0, e1->tok);
+    return value_newNumber(0);
 }
 
 ExecValue* value_opNEq(ExecValue *e1, ExecValue *e2)
@@ -469,7 +512,7 @@ ExecValue* value_opNEq(ExecValue *e1, ExecValue *e2)
         criticalError("neq: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
     
     ExecValue *eqeqRes = value_opEqEq(e1, e2);
-    eqeqRes->value.literal_num = !eqeqRes->value.literal_num;
+    value_setNumber(eqeqRes, !value_toDouble(eqeqRes));
     return eqeqRes;
 }
 
@@ -481,35 +524,19 @@ ExecValue* value_opGt(ExecValue *e1, ExecValue *e2)
         criticalError("gt: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num > e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        double result = value_toDouble(e1) > value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
-        // e1 is gt if it "collates after" e2 i.e. if the first non-matching char in e1 is greater than e2 in ASCII
-        // We compare them by strcmp with the smaller size, and if it's still a match, the string with the larger size is greater
-        char *s1 = e1->value.literal_str; 
-        char *s2 = e2->value.literal_str;
-        size_t s1Len = strlen(s1);
-        size_t s2Len = strlen(s2);
-        size_t smallerLen = (s1Len < s2Len) ? s1Len : s2Len;
-
-        int comparison = strncmp(s1, s2, smallerLen);
-        if (comparison != 0) {
-            double value = (comparison > 0) ? 1 : 0;
-            return value_newNumber(value, e1->tok);
-        }
-        
-        if (s1Len > s2Len)
-            return value_newNumber(1, e1->tok);
-        return value_newNumber(0, e1->tok);
+        // e1 is gt if it "collates after" e2 i.e. if the first non-matching char in e1 is greater than e2 in ASCII,
+        // or if there's none and e1 is longer
+        double result = stringref_compare(e1->value.string_ref, e2->value.string_ref) > 0;
+        return value_newNumber(result);
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "greaterThan expects two numbers or two strings, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER || e1->type == TYPE_STRING)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_GT_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER || e1->type == TYPE_STRING);
 }
 
 ExecValue* value_opGEq(ExecValue *e1, ExecValue *e2)
@@ -520,11 +547,11 @@ ExecValue* value_opGEq(ExecValue *e1, ExecValue *e2)
         criticalError("geq: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num >= e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        double result = value_toDouble(e1) >= value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
         ExecValue *gt = value_opGt(e1, e2);
-        if (gt->value.literal_num == 0) {
+        if (value_toDouble(gt) == 0) {
             value_free(gt);
             return value_opEqEq(e1, e2);
         }
@@ -532,12 +559,9 @@ ExecValue* value_opGEq(ExecValue *e1, ExecValue *e2)
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "greaterThanOrEqualTo expects two numbers or two strings, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER || e1->type == TYPE_STRING)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_GEQ_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER || e1->type == TYPE_STRING);
 }
 
 ExecValue* value_opLt(ExecValue *e1, ExecValue *e2)
@@ -548,22 +572,19 @@ ExecValue* value_opLt(ExecValue *e1, ExecValue *e2)
         criticalError("lt: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num < e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        double result = value_toDouble(e1) < value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
         // < is the complement of >=
         ExecValue *geq = value_opGEq(e1, e2);
-        geq->value.literal_num = (geq->value.literal_num == 0) ? 1 : 0;
+        value_setNumber(geq, value_toDouble(geq) == 0);
         return geq;
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "lessThan expects two numbers or two strings, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER || e1->type == TYPE_STRING)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_LT_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER || e1->type == TYPE_STRING);
 }
 
 ExecValue* value_opLEq(ExecValue *e1, ExecValue *e2)
@@ -574,20 +595,17 @@ ExecValue* value_opLEq(ExecValue *e1, ExecValue *e2)
         criticalError("leq: pass the VALUE of the identifier into this function with context_getValue(), instead of the identifier itself.");
 
     if (e1->type == TYPE_NUMBER && e2->type == TYPE_NUMBER) {
-        double result = e1->value.literal_num <= e2->value.literal_num;
-        return value_newNumber(result, e1->tok);
+        double result = value_toDouble(e1) <= value_toDouble(e2);
+        return value_newNumber(result);
     } else if (e1->type == TYPE_STRING && e2->type == TYPE_STRING) {
         // <= is the complement of >
         ExecValue *gt = value_opGt(e1, e2);
-        gt->value.literal_num = (gt->value.literal_num == 0) ? 1 : 0;
+        value_setNumber(gt, value_toDouble(gt) == 0);
         return gt;
     }
 
     // Invalid types
-    Error *typeErr = error_new(ERR_RUNTIME_TYPE, -1, -1);
-    snprintf(typeErr->message, MAX_ERRMSG_LEN, "lessThanOrEqualTo expects two numbers or two strings, instead got values of type %s and %s", ValueTypeString[e1->type], ValueTypeString[e2->type]);
-    if (e1->type == TYPE_NUMBER || e1->type == TYPE_STRING)
-        return value_newError(typeErr, e2->tok);
-    else
-        return value_newError(typeErr, e1->tok);
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_LEQ_TYPES, -1, -1);
+    error_withArgs(typeErr, ValueTypeString[e1->type], ValueTypeString[e2->type]);
+    return _value_operandError(typeErr, e1->type == TYPE_NUMBER || e1->type == TYPE_STRING);
 }
@@ -1,7 +1,11 @@
 #ifndef _EXECVALUE_H
 #define _EXECVALUE_H
+#include <math.h>
+#include <stdint.h>
 #include "../parser/symbol.h"
 #include "../error/error.h"
+#include "../memory/pool.h"
+#include "stringref.h"
 
 typedef enum {
     TYPE_NUMBER,
@@ -15,39 +19,119 @@ typedef enum {
 
 static const char* ValueTypeString[] = {"TYPE_NUMBER", "TYPE_STRING", "TYPE_NULL", "TYPE_IDENTIFIER", "TYPE_FUNCTION", "TYPE_ERROR", "TYPE_UNASSIGNED"};
 
-// A function reference
+struct _fnmemo;
+struct _numfn;
+
+// A function reference. Clones of a function value share the same FunctionRef.
 typedef struct {
     ASTNode* argList;
     ASTNode* fnBlk;
+    size_t refCount;
+    ErrorContext* errorCtx; // Source the function was defined in, which its errors are shown with
+    struct _fnmemo* memo; // Purity and result cache, see memo.h
+    size_t callCount;
+    struct _numfn* numeric; // Compiled numeric code, see numeric.h
+    ASTNode* inlineExpr;    // Expression that calls evaluate in place, or NULL, see inliner.h
+    size_t inlineEpoch;     // Value of memo_epoch when inlineExpr was decided, SIZE_MAX before that
 } FunctionRef;
 
-// A value that is assigned, or an identifier name.
-typedef struct {
-    ValueType type;
+// Largest integer a number can hold as an int64, 2^53. Every integer up to it is exact as a double too.
+#define VALUE_INT_MAX 9007199254740992LL
+
+// A value that is assigned, or an identifier name. Values are shared: value_clone() adds a reference to the same
+// ExecValue, and value_free() drops one. A value is only changed in place through value_own().
+// A number is an int64 in literal_int if it's integral, not -0 and within VALUE_INT_MAX, and a double in literal_num
+// otherwise. Both give the same results, so only value_setNumber() and the integer fast paths look at isInt.
+// Values don't know where in the source they come from: the executor gives an error its position from the node that
+// made it, see value_locate().
+typedef struct _execvalue {
+    ValueType type : 8;
+    unsigned int isInt : 1;        // TYPE_NUMBER only: the number is in literal_int
+    unsigned int rightOperand : 1; // TYPE_ERROR only: a binary operator's error is about its right operand, not its left
+    uint32_t refCount;
     union {
         void* literal_null;
         double literal_num;
-        char* literal_str;
+        int64_t literal_int;
+        StringRef* string_ref;
         char* identifier_name;
         FunctionRef* function_ref;
         Error* error_ptr;
     } value;
-    Token* tok; // Used to add context for the ExecValue
 } ExecValue;
 
+// Pools of every ExecValue and FunctionRef, see pool.h
+extern Pool valuePool;
+extern Pool functionPool;
 
 // Defines new ExecValues
 ExecValue* value_newNull();
-ExecValue* value_newString(char* strValue, Token* tokPtr);
-ExecValue* value_newNumber(double numValue, Token* tokPtr);
-ExecValue* value_newIdentifier(char *identifierName, Token* tokPtr);
-ExecValue* value_newError(Error *err, Token* tokPtr);
-ExecValue* value_newFunction(ASTNode* argList, ASTNode* block, Token* tokPtr);
+ExecValue* value_newString(char* strValue);
+ExecValue* value_newStringRef(StringRef* ref); // Takes over the reference to `ref`
+ExecValue* value_newNumber(double numValue);
+ExecValue* value_newInt(int64_t numValue);
+ExecValue* value_newIdentifier(char *identifierName);
+ExecValue* value_newError(Error *err);
+ExecValue* value_newFunction(ASTNode* argList, ASTNode* block);
+
+// Gives the error `val` the position of `tok` in errorContext, unless it already has one or `tok` is NULL. Returns `val`.
+ExecValue* value_locate(ExecValue *val, Token *tok);
+
+// Stores `num` in the number `val`, as an int64 if it can be one.
+void value_setNumber(ExecValue *val, double num);
+
+// Returns 1 if `num` can be held as an int64, see VALUE_INT_MAX.
+static inline int value_isIntegral(double num)
+{
+    return num >= -VALUE_INT_MAX && num <= VALUE_INT_MAX && num == (double) (int64_t) num && !(num == 0 && signbit(num));
+}
 
-// Clones an ExecValue
+// Returns the number `val` as a double.
+static inline double value_toDouble(const ExecValue *val)
+{
+    return val->isInt ? (double) val->value.literal_int : val->value.literal_num;
+}
+
+// Runs the integer operation `op` (+, -, * or %) on `l` and `r`. Returns 1 and sets `*result` if the double operation
+// would give the same integer, or 0 if the operation has to run on doubles: on overflow past VALUE_INT_MAX, a
+// remainder of division by 0, or a result of -0.
+static inline int value_intArith(TokenType op, int64_t l, int64_t r, int64_t *result)
+{
+    int64_t n;
+    switch (op) {
+    case TOKEN_PLUS:  n = l + r; break;
+    case TOKEN_MINUS: n = l - r; break;
+    case TOKEN_STAR:
+        if (__builtin_mul_overflow(l, r, &n) || (n == 0 && (l < 0 || r < 0)))
+            return 0;
+        break;
+    case TOKEN_PERCENT:
+        if (r == 0)
+            return 0;
+        n = l % r;
+        if (n == 0 && l < 0)
+            return 0;
+        break;
+    default:
+        return 0;
+    }
+    if (n < -VALUE_INT_MAX || n > VALUE_INT_MAX)
+        return 0;
+    *result = n;
+    return 1;
+}
+
+// Returns the null-terminated characters of the string `val`, see stringref_chars().
+char* value_str(ExecValue *val);
+
+// Adds a reference to `val`, and returns it.
 ExecValue* value_clone(ExecValue *val);
 
-// Frees an ExecValue
+// Returns `val` if this is its only reference, or a NEW copy that takes the place of this reference, which can be
+// changed in place without changing the value for anyone else. Errors can't be owned.
+ExecValue* value_own(ExecValue *val);
+
+// Drops a reference to `value`, freeing it with the last one.
 void value_free(ExecValue *value);
 
 // Returns 0 if the value is FALSE, 1 if TRUE. -1 for an invalid type.
@@ -72,4 +156,7 @@ ExecValue* value_opGEq(ExecValue*, ExecValue*);
 ExecValue* value_opLt(ExecValue*, ExecValue*);
 ExecValue* value_opLEq(ExecValue*, ExecValue*);
 
+// Returns a NEW string ExecValue with two strings joined, without checking their types.
+ExecValue* value_concat(ExecValue*, ExecValue*);
+
 #endif
@@ -0,0 +1,238 @@
+#include <math.h>
+#include <string.h>
+#include "../logger/logger.h"
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+#include "fusion.h"
+
+static const char *FusionString[] = {"none", "local arithmetic", "compare", "modulo equals"};
+
+// Per fusion: nodes marked, runs on the fused path, and runs that fell back to the node chain.
+size_t fusionNodes[FUSE_COUNT];
+size_t fusionHits[FUSE_COUNT];
+size_t fusionFallbacks[FUSE_COUNT];
+
+// Skips the nodes with a single child. Returns the first node with more children, or the TERMINAL at the bottom.
+ASTNode *_fusion_skip(ASTNode *node)
+{
+    while (node->type != SYM_TERMINAL && node->numChildren == 1)
+        node = node->children[0];
+    return node;
+}
+
+// Returns the TERMINAL that `node` evaluates to if it's a variable or number, including through ( EXPR ). Otherwise NULL.
+ASTNode *_fusion_operand(ASTNode *node)
+{
+    node = _fusion_skip(node);
+    while (node->type == SYM_PRIMARY && node->numChildren == 3)
+        node = _fusion_skip(node->children[1]);
+
+    if (node->type != SYM_TERMINAL)
+        return NULL;
+    if (node->tok->type != TOKEN_IDENTIFIER && node->tok->type != TOKEN_NUMBER)
+        return NULL;
+    return node;
+}
+
+// Returns the OP node of `node` if it's operand OP operand, with OP in `ops`. Otherwise NULL.
+ASTNode *_fusion_binary(ASTNode *node, const TokenType *ops, size_t opCount)
+{
+    node = _fusion_skip(node);
+    if (node->type == SYM_TERMINAL || node->type == SYM_PRIMARY || node->numChildren != 3)
+        return NULL;
+
+    int found = 0;
+    for (size_t i = 0; i < opCount; i++)
+        if (node->children[1]->tok->type == ops[i])
+            found = 1;
+    if (!found)
+        return NULL;
+
+    if (_fusion_operand(node->children[0]) == NULL || _fusion_operand(node->children[2]) == NULL)
+        return NULL;
+    return node;
+}
+
+static const TokenType arithOps[] = {TOKEN_PLUS, TOKEN_MINUS, TOKEN_STAR, TOKEN_SLASH};
+static const TokenType compareOps[] = {TOKEN_GREATER, TOKEN_GREATER_EQUAL, TOKEN_LESS, TOKEN_LESS_EQUAL};
+static const TokenType modOps[] = {TOKEN_PERCENT};
+
+// Returns the fusion for `node` itself.
+Fusion _fusion_match(ASTNode *node)
+{
+    switch (node->type) {
+    case SYM_ASMT: {
+        // x = x OP y
+        if (node->numChildren != 4 || node->children[2]->type != SYM_EXPR)
+            return FUSE_NONE;
+        ASTNode *op = _fusion_binary(node->children[2], arithOps, 4);
+        if (op == NULL)
+            return FUSE_NONE;
+        ASTNode *left = _fusion_operand(op->children[0]);
+        if (left->tok->type != TOKEN_IDENTIFIER || strcmp(left->tok->lexeme, node->children[0]->tok->lexeme) != 0)
+            return FUSE_NONE;
+        return FUSE_LOCAL_ARITH;
+    }
+    case SYM_COMPARISON: {
+        // x < y
+        if (_fusion_binary(node, compareOps, 4) != node)
+            return FUSE_NONE;
+        if (_fusion_operand(node->children[0])->tok->type != TOKEN_IDENTIFIER)
+            return FUSE_NONE;
+        return FUSE_COMPARE;
+    }
+    case SYM_EQUALITY: {
+        // x % y == z
+        if (node->numChildren != 3)
+            return FUSE_NONE;
+        TokenType eqOp = node->children[1]->tok->type;
+        if (eqOp != TOKEN_EQUAL_EQUAL && eqOp != TOKEN_BANG_EQUAL)
+            return FUSE_NONE;
+        if (_fusion_binary(node->children[0], modOps, 1) == NULL || _fusion_operand(node->children[2]) == NULL)
+            return FUSE_NONE;
+        return FUSE_MOD_EQ;
+    }
+    default:
+        return FUSE_NONE;
+    }
+}
+
+void fusion_annotate(ASTNode *node)
+{
+    if (node == NULL)
+        return;
+
+    node->fused = _fusion_match(node);
+    if (node->fused != FUSE_NONE)
+        fusionNodes[node->fused]++;
+
+    for (size_t i = 0; i < node->numChildren; i++)
+        fusion_annotate(node->children[i]);
+}
+
+// Finds the value of a variable or number TERMINAL without copying it.
+// Returns 1 and sets `*num` to the number, or 0 if it's not a number.
+int _fusion_number(Context *ctx, ASTNode *terminal, ExecValue *num)
+{
+    if (terminal->tok->type == TOKEN_NUMBER) {
+        num->type = TYPE_NUMBER;
+        value_setNumber(num, terminal->tok->literal.literal_num);
+        return 1;
+    }
+
+    ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = terminal->tok->lexeme};
+    ExecSymbol *sym = context_getSymbol(ctx, &identifier);
+    if (sym == NULL && ctx->global != NULL)
+        sym = context_getSymbol(ctx->global, &identifier);
+    if (sym == NULL || sym->value->type != TYPE_NUMBER)
+        return 0;
+
+    *num = *sym->value;
+    return 1;
+}
+
+// Gives the node back to the node chain for good, the same way a failed quickening guard does.
+void _fusion_fallback(ASTNode *node)
+{
+    fusionFallbacks[node->fused]++;
+    node->fused = FUSE_NONE;
+}
+
+int fusion_asmt(Context *ctx, ASTNode *asmt)
+{
+    ASTNode *op = asmt->rhs;
+
+    // Only a variable of this scope can be updated in place, otherwise the assignment declares it
+    ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = asmt->lhs->tok->lexeme};
+    ExecSymbol *sym = context_getSymbol(ctx, &identifier);
+    ExecValue r;
+    if (sym == NULL || sym->value->type != TYPE_NUMBER || !_fusion_number(ctx, op->rhs, &r)) {
+        _fusion_fallback(asmt);
+        return 0;
+    }
+
+    // The variable may share its value, with another variable or a cache
+    ExecValue *l = sym->value = value_own(sym->value);
+    int64_t n;
+    fusionHits[FUSE_LOCAL_ARITH]++;
+    if (l->isInt && r.isInt && value_intArith(op->op, l->value.literal_int, r.value.literal_int, &n)) {
+        l->value.literal_int = n;
+        return 1;
+    }
+
+    double result = 0;
+    switch (op->op) {
+    case TOKEN_PLUS:  result = value_toDouble(l) + value_toDouble(&r); break;
+    case TOKEN_MINUS: result = value_toDouble(l) - value_toDouble(&r); break;
+    case TOKEN_STAR:  result = value_toDouble(l) * value_toDouble(&r); break;
+    case TOKEN_SLASH: result = value_toDouble(l) / value_toDouble(&r); break;
+    default:
+        criticalError("fusion_asmt: Unexpected operator.");
+    }
+    value_setNumber(l, result);
+    return 1;
+}
+
+ExecValue *fusion_compare(Context *ctx, ASTNode *comparison)
+{
+    ExecValue lVal, rVal;
+    if (!_fusion_number(ctx, comparison->lhs, &lVal) || !_fusion_number(ctx, comparison->rhs, &rVal)) {
+        _fusion_fallback(comparison);
+        return NULL;
+    }
+
+    double l = value_toDouble(&lVal), r = value_toDouble(&rVal);
+    double result = 0;
+    switch (comparison->op) {
+    case TOKEN_GREATER:       result = l > r; break;
+    case TOKEN_GREATER_EQUAL: result = l >= r; break;
+    case TOKEN_LESS:          result = l < r; break;
+    case TOKEN_LESS_EQUAL:    result = l <= r; break;
+    default:
+        criticalError("fusion_compare: Unexpected operator.");
+    }
+    fusionHits[FUSE_COMPARE]++;
+    return value_newInt(result);
+}
+
+ExecValue *fusion_modEq(Context *ctx, ASTNode *equality)
+{
+    ASTNode *mod = equality->lhs;
+    ExecValue a, b, c;
+    if (!_fusion_number(ctx, mod->lhs, &a) ||
+        !_fusion_number(ctx, mod->rhs, &b) ||
+        !_fusion_number(ctx, equality->rhs, &c)) {
+        _fusion_fallback(equality);
+        return NULL;
+    }
+
+    // Integers take the remainder without fmod()
+    int64_t n;
+    double remainder;
+    if (a.isInt && b.isInt && value_intArith(TOKEN_PERCENT, a.value.literal_int, b.value.literal_int, &n))
+        remainder = n;
+    else
+        remainder = fmod(value_toDouble(&a), value_toDouble(&b));
+
+    double result = remainder == value_toDouble(&c);
+    if (equality->op == TOKEN_BANG_EQUAL)
+        result = !result;
+    fusionHits[FUSE_MOD_EQ]++;
+    return value_newInt(result);
+}
+
+void fusion_report()
+{
+    int header = 0;
+    for (Fusion fusion = FUSE_NONE + 1; fusion < FUSE_COUNT; fusion++) {
+        if (fusionHits[fusion] + fusionFallbacks[fusion] == 0)
+            continue;
+        if (!header) {
+            log_message(&executionLogger, "\n--- FUSION REPORT ---\n");
+            header = 1;
+        }
+        log_message(&executionLogger, "%s: %lu nodes, %lu fused runs, %lu fallbacks\n", FusionString[fusion], fusionNodes[fusion], fusionHits[fusion], fusionFallbacks[fusion]);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef _FUSION_H_
+#define _FUSION_H_
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+
+/**
+Superinstructions for common statement shapes. fusion_annotate() marks the nodes before they are
+lowered, and the executor runs a marked node with its fusion_* function. A fused node works on numbers only,
+straight from the symbol tables, and falls back to the normal node chain for anything else.
+ */
+
+// Marks every node under `node` that matches a fusion pattern.
+void fusion_annotate(ASTNode *node);
+
+// Runs a FUSE_LOCAL_ARITH assignment. Returns 0 if the assignment has to run normally.
+int fusion_asmt(Context *ctx, ASTNode *asmt);
+
+// Returns a NEW ExecValue with the result of a FUSE_COMPARE comparison, or NULL if it has to run normally.
+ExecValue *fusion_compare(Context *ctx, ASTNode *comparison);
+
+// Returns a NEW ExecValue with the result of a FUSE_MOD_EQ equality, or NULL if it has to run normally.
+ExecValue *fusion_modEq(Context *ctx, ASTNode *equality);
+
+// Logs how many nodes of each fusion were found, and how many of their runs took the fused path.
+void fusion_report();
+
+#endif
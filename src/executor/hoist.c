@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../memory/allocator.h"
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+#include "hoist.h"
+
+// Number of loop runs started, used to tell the runs apart.
+size_t hoistRuns = 0;
+
+// The variables assigned in a loop. The names are not owned by the set.
+typedef struct {
+    char **names;
+    size_t count;
+    size_t capacity;
+} WriteSet;
+
+void _hoist_collectWrites(ASTNode *node, WriteSet *writes)
+{
+    // Assignments in a function body are to the function's own scope
+    if (node->type == SYM_FN_EXPR)
+        return;
+    if (node->type == SYM_ASMT) {
+        if (writes->count == writes->capacity) {
+            writes->capacity = writes->capacity == 0 ? 16 : writes->capacity * 2;
+            writes->names = mem_realloc(writes->names, sizeof(char *) * writes->capacity);
+        }
+        writes->names[writes->count++] = node->children[0]->tok->lexeme;
+    }
+    for (size_t i = 0; i < node->numChildren; i++)
+        _hoist_collectWrites(node->children[i], writes);
+}
+
+int _hoist_isWritten(WriteSet *writes, char *name)
+{
+    for (size_t i = 0; i < writes->count; i++)
+        if (strcmp(writes->names[i], name) == 0)
+            return 1;
+    return 0;
+}
+
+// Returns 1 if `node` is an operator node, which has more than one child.
+int _hoist_isOperator(ASTNode *node)
+{
+    switch (node->type) {
+    case SYM_OR_EXPR: case SYM_AND_EXPR: case SYM_LOG_UNARY: case SYM_EQUALITY:
+    case SYM_COMPARISON: case SYM_SUM: case SYM_TERM: case SYM_UNARY: case SYM_POWER:
+        return node->numChildren > 1;
+    default:
+        return 0;
+    }
+}
+
+// Returns 1 if `node` has no calls, and reads no variable in `writes`.
+int _hoist_isInvariant(ASTNode *node, WriteSet *writes)
+{
+    if (node->type == SYM_FN_CALL || node->type == SYM_FN_EXPR)
+        return 0;
+    if (node->type == SYM_TERMINAL && node->tok->type == TOKEN_IDENTIFIER)
+        return !_hoist_isWritten(writes, node->tok->lexeme);
+
+    for (size_t i = 0; i < node->numChildren; i++)
+        if (!_hoist_isInvariant(node->children[i], writes))
+            return 0;
+    return 1;
+}
+
+// Hoists the largest invariant expressions under `node` to `loop`.
+void _hoist_mark(ASTNode *node, ASTNode *loop, WriteSet *writes)
+{
+    if (node->type == SYM_FN_EXPR || node->hoist != NULL)
+        return;
+
+    if (_hoist_isOperator(node) && node->eval != NULL && _hoist_isInvariant(node, writes)) {
+        node->hoist = mem_calloc(1, sizeof(Hoist));
+        node->hoist->eval = node->eval;
+        node->hoist->loop = loop;
+        node->eval = execHoisted;
+
+        if (loop->hoist == NULL)
+            loop->hoist = mem_calloc(1, sizeof(Hoist));
+        Hoist *loopHoist = loop->hoist;
+        if (loopHoist->memberCount == loopHoist->memberCapacity) {
+            loopHoist->memberCapacity = loopHoist->memberCapacity == 0 ? 4 : loopHoist->memberCapacity * 2;
+            loopHoist->members = mem_realloc(loopHoist->members, sizeof(ASTNode *) * loopHoist->memberCapacity);
+        }
+        loopHoist->members[loopHoist->memberCount++] = node;
+        return;
+    }
+
+    for (size_t i = 0; i < node->numChildren; i++)
+        _hoist_mark(node->children[i], loop, writes);
+}
+
+void hoist_analyze(ASTNode *node)
+{
+    // Function bodies are analyzed when they're lowered as function values
+    if (node->type == SYM_FN_EXPR)
+        return;
+
+    // Outer loops go first, so that an expression goes to the outermost loop it's invariant in
+    if (node->type == SYM_WHILE) {
+        WriteSet writes = {NULL, 0, 0};
+        _hoist_collectWrites(node, &writes);
+        for (size_t i = 0; i < node->numChildren; i++)
+            _hoist_mark(node->children[i], node, &writes);
+        mem_free(writes.names);
+    }
+
+    for (size_t i = 0; i < node->numChildren; i++)
+        hoist_analyze(node->children[i]);
+}
+
+size_t hoist_enter(ASTNode *loop)
+{
+    if (loop->hoist == NULL)
+        return 0;
+    size_t outer = loop->hoist->activation;
+    loop->hoist->activation = ++hoistRuns;
+    return outer;
+}
+
+void hoist_exit(ASTNode *loop, size_t outer)
+{
+    Hoist *loopHoist = loop->hoist;
+    if (loopHoist == NULL)
+        return;
+
+    for (size_t i = 0; i < loopHoist->memberCount; i++) {
+        Hoist *hoist = loopHoist->members[i]->hoist;
+        if (hoist->value != NULL && hoist->activation == loopHoist->activation) {
+            value_free(hoist->value);
+            hoist->value = NULL;
+        }
+    }
+    loopHoist->activation = outer;
+}
+
+ExecValue *hoist_lookup(ASTNode *node)
+{
+    Hoist *hoist = node->hoist;
+    if (hoist->value == NULL || hoist->activation != hoist->loop->hoist->activation)
+        return NULL;
+    return value_clone(hoist->value);
+}
+
+void hoist_store(ASTNode *node, ExecValue *val)
+{
+    if (val->type == TYPE_ERROR || val->type == TYPE_IDENTIFIER)
+        return;
+
+    Hoist *hoist = node->hoist;
+    if (hoist->value != NULL)
+        value_free(hoist->value);
+    hoist->value = value_clone(val);
+    hoist->activation = hoist->loop->hoist->activation;
+}
@@ -0,0 +1,31 @@
+#ifndef _HOIST_H_
+#define _HOIST_H_
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+
+/**
+Loop-invariant expressions. An operator node inside a while loop is invariant if it only reads
+variables that aren't assigned anywhere in the loop, and has no function calls. Its value is
+computed the first time it's needed in a run of the loop, and reused for the rest of that run.
+A recursive call that runs the same loop again starts a run of its own.
+ */
+
+// Finds the invariant expressions of every while loop under `node`, which must already be lowered.
+// They're hoisted to the outermost loop they're invariant in, and evaluated by execHoisted().
+void hoist_analyze(ASTNode *node);
+
+// Starts a run of `loop`. Returns the run it interrupted, to be passed to hoist_exit().
+size_t hoist_enter(ASTNode *loop);
+
+// Ends the current run of `loop`, freeing the values from it.
+void hoist_exit(ASTNode *loop, size_t outer);
+
+// Returns a NEW reference to the value of `node` in the current run of its loop, or NULL if it wasn't computed yet.
+ExecValue *hoist_lookup(ASTNode *node);
+
+// Keeps a reference to `val` as the value of `node` for the current run of its loop. Errors aren't kept.
+void hoist_store(ASTNode *node, ExecValue *val);
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+#include "memo.h"
+#include "inliner.h"
+
+size_t _inliner_size(ASTNode *node)
+{
+    size_t size = 1;
+    for (size_t i = 0; i < node->numChildren; i++)
+        size += _inliner_size(node->children[i]);
+    return size;
+}
+
+// Returns 1 if `node` calls `fnRef` by its global name.
+int _inliner_callsSelf(ASTNode *node, FunctionRef *fnRef, Context *global)
+{
+    if (node->type == SYM_FN_CALL) {
+        ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = node->children[0]->tok->lexeme};
+        ExecSymbol *sym = context_getSymbol(global, &identifier);
+        if (sym != NULL && sym->value->type == TYPE_FUNCTION && sym->value->value.function_ref == fnRef)
+            return 1;
+    }
+    for (size_t i = 0; i < node->numChildren; i++)
+        if (_inliner_callsSelf(node->children[i], fnRef, global))
+            return 1;
+    return 0;
+}
+
+// Returns the expression calls to `fnRef` can evaluate in place, or NULL.
+ASTNode *_inliner_expr(FunctionRef *fnRef, Context *global)
+{
+    if (fnRef->inlineEpoch == memo_epoch)
+        return fnRef->inlineExpr;
+    fnRef->inlineEpoch = memo_epoch;
+    fnRef->inlineExpr = NULL;
+
+    ASTNode *block = fnRef->fnBlk;
+    if (block->numChildren != 1)
+        return NULL;
+    ASTNode *ret = block->children[0]->lhs;
+    if (ret->type != SYM_RETURN || ret->lhs == NULL)
+        return NULL;
+
+    // Default values and repeated names are left to execArgList
+    ASTNode *argList = fnRef->argList;
+    for (size_t i = 0; i < argList->numChildren; i++) {
+        ASTNode *arg = argList->children[i];
+        if (arg->type != SYM_ARG)
+            continue;
+        if (arg->rhs != NULL)
+            return NULL;
+        for (size_t j = 0; j < i; j++)
+            if (argList->children[j]->type == SYM_ARG &&
+                strcmp(argList->children[j]->lhs->tok->lexeme, arg->lhs->tok->lexeme) == 0)
+                return NULL;
+    }
+
+    if (_inliner_size(ret->lhs) > INLINE_MAX_NODES || _inliner_callsSelf(ret->lhs, fnRef, global))
+        return NULL;
+    fnRef->inlineExpr = ret->lhs;
+    return fnRef->inlineExpr;
+}
+
+size_t _inliner_count(ASTNode *list, SymbolType type)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < list->numChildren; i++)
+        if (list->children[i]->type == type)
+            count++;
+    return count;
+}
+
+ExecValue *inliner_call(Context *ctx, ASTNode *fnCall, FunctionRef *fnRef)
+{
+    Context *global = ctx->global != NULL ? ctx->global : ctx;
+    ASTNode *expr = _inliner_expr(fnRef, global);
+    if (expr == NULL)
+        return NULL;
+
+    // A wrong number of arguments is reported by execFnArgs
+    ASTNode *argList = fnRef->argList;
+    ASTNode *fnArgs = fnCall->rhs;
+    size_t paramCount = _inliner_count(argList, SYM_ARG);
+    if (_inliner_count(fnArgs, SYM_EXPR) != paramCount)
+        return NULL;
+
+    // Bind the arguments, evaluated in the caller's scope, the same way a function context would
+    ExecSymbol params[paramCount + 1];
+    ExecSymbol *paramPtrs[paramCount + 1];
+    size_t bound = 0;
+    ExecValue *retVal = NULL;
+    for (size_t i = 0, j = 0; i < argList->numChildren && retVal == NULL; i++) {
+        if (argList->children[i]->type != SYM_ARG)
+            continue;
+        while (fnArgs->children[j]->type != SYM_EXPR)
+            j++;
+
+        ExecValue *value = execOperand(ctx, fnArgs->children[j++]->lhs);
+        if (value->type == TYPE_ERROR) {
+            retVal = value;
+            break;
+        }
+        params[bound] = (ExecSymbol) {argList->children[i]->lhs->tok->lexeme, value};
+        paramPtrs[bound] = &params[bound];
+        bound++;
+    }
+
+    if (retVal == NULL) {
+        Context frame = {global, ctx, paramCount, paramPtrs, paramCount, 0, 0};
+        ErrorContext *callerErrorCtx = errorContext;
+        errorContext = fnRef->errorCtx;
+        retVal = execOperand(&frame, expr);
+        errorContext = callerErrorCtx;
+    }
+    for (size_t i = 0; i < bound; i++)
+        value_free(params[i].value);
+    return retVal;
+}
@@ -0,0 +1,23 @@
+#ifndef _INLINER_H_
+#define _INLINER_H_
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+
+// Largest returned expression, in AST nodes, that calls evaluate in place.
+#define INLINE_MAX_NODES 64
+
+/**
+Inlining of small global functions. A function whose body is a single `return EXPR`, with no
+default parameters and no call to itself, is called by evaluating EXPR in place: the arguments
+are bound in a frame on the C stack, instead of a Context built by execArgList and execFnArgs,
+and there is no execBlock. The decision is kept on the FunctionRef until memo_epoch changes,
+which happens whenever a global function is rebound.
+ */
+
+// Returns a NEW ExecValue with the result of calling `fnRef` in place from `fnCall`, or NULL if the call has to
+// go through execFnCall. `fnRef` must be the function bound to the called name in the global scope.
+ExecValue *inliner_call(Context *ctx, ASTNode *fnCall, FunctionRef *fnRef);
+
+#endif
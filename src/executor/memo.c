@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../logger/logger.h"
+#include "../memory/allocator.h"
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+#include "memo.h"
+
+size_t memo_epoch = 0;
+size_t memoHits = 0;
+size_t memoMisses = 0;
+
+// Every live FnMemo, so that they can be reported.
+FnMemo *memoList = NULL;
+
+// Functions whose purity was decided in the current analysis round.
+FnMemo **memoRound = NULL;
+size_t memoRoundCount = 0;
+int memoRoundDepth = 0;
+
+// A list of identifier names. The names are not owned by the set.
+typedef struct {
+    char **names;
+    size_t count;
+} NameSet;
+
+void _nameset_add(NameSet *set, char *name)
+{
+    set->count++;
+    set->names = mem_realloc(set->names, sizeof(char *) * set->count);
+    set->names[set->count - 1] = name;
+}
+
+int _nameset_has(NameSet *set, char *name)
+{
+    for (size_t i = 0; i < set->count; i++)
+        if (strcmp(set->names[i], name) == 0)
+            return 1;
+    return 0;
+}
+
+FnMemo *memo_new()
+{
+    FnMemo *memo = mem_alloc(sizeof(FnMemo));
+    memo->name = NULL;
+    memo->purity = PURITY_UNKNOWN;
+    memo->epoch = memo_epoch;
+    memo->entries = NULL;
+    memo->hits = 0;
+    memo->misses = 0;
+
+    memo->prev = NULL;
+    memo->next = memoList;
+    if (memoList != NULL)
+        memoList->prev = memo;
+    memoList = memo;
+    return memo;
+}
+
+void _memo_flush(FnMemo *memo)
+{
+    if (memo->entries == NULL)
+        return;
+    for (size_t i = 0; i < MEMO_CACHE_SIZE; i++) {
+        MemoEntry *entry = &memo->entries[i];
+        if (entry->result == NULL)
+            continue;
+        for (size_t j = 0; j < entry->argCount; j++)
+            value_free(entry->args[j]);
+        mem_free(entry->args);
+        value_free(entry->result);
+    }
+    mem_free(memo->entries);
+    memo->entries = NULL;
+}
+
+void memo_free(FnMemo *memo)
+{
+    _memo_flush(memo);
+    if (memo->prev != NULL)
+        memo->prev->next = memo->next;
+    else
+        memoList = memo->next;
+    if (memo->next != NULL)
+        memo->next->prev = memo->prev;
+    mem_free(memo->name);
+    mem_free(memo);
+}
+
+// Adds the names of all variables assigned anywhere under `node` to `locals`.
+void _memo_collectLocals(ASTNode *node, NameSet *locals)
+{
+    if (node->type == SYM_ASMT)
+        _nameset_add(locals, node->children[0]->tok->lexeme);
+    for (size_t i = 0; i < node->numChildren; i++)
+        _memo_collectLocals(node->children[i], locals);
+}
+
+// Returns 1 if `node` is free of side effects and global reads.
+// - `defined`: variables that are definitely assigned at this point of the function.
+// - `locals`: every parameter and variable assigned in the function.
+int _memo_walk(ASTNode *node, NameSet *defined, NameSet *locals, Context *global)
+{
+    switch (node->type) {
+    case SYM_PRNT_STMT:
+    case SYM_FN_EXPR:
+        return 0;
+    case SYM_ASMT:
+        if (!_memo_walk(node->children[2], defined, locals, global))
+            return 0;
+        _nameset_add(defined, node->children[0]->tok->lexeme);
+        return 1;
+    case SYM_BLOCK: {
+        // Assignments in a nested block don't dominate the lines after the block
+        size_t mark = defined->count;
+        for (size_t i = 0; i < node->numChildren; i++) {
+            if (!_memo_walk(node->children[i], defined, locals, global))
+                return 0;
+        }
+        defined->count = mark;
+        return 1;
+    }
+    case SYM_FN_CALL: {
+        // The callee must be a pure global function, which a local can't shadow
+        char *name = node->children[0]->tok->lexeme;
+        if (_nameset_has(locals, name))
+            return 0;
+        ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = name};
+        ExecSymbol *sym = context_getSymbol(global, &identifier);
+        if (sym == NULL || sym->value->type != TYPE_FUNCTION)
+            return 0;
+        if (!memo_isPure(sym->value->value.function_ref, global))
+            return 0;
+        return _memo_walk(node->children[2], defined, locals, global);
+    }
+    case SYM_TERMINAL:
+        if (node->tok->type == TOKEN_IDENTIFIER)
+            return _nameset_has(defined, node->tok->lexeme);
+        return 1;
+    default:
+        for (size_t i = 0; i < node->numChildren; i++) {
+            if (!_memo_walk(node->children[i], defined, locals, global))
+                return 0;
+        }
+        return 1;
+    }
+}
+
+int _memo_analyse(FunctionRef *fnRef, Context *global)
+{
+    NameSet defined = {mem_alloc(0), 0};
+    NameSet locals = {mem_alloc(0), 0};
+
+    // Parameters are always assigned once the arguments are bound
+    ASTNode *argList = fnRef->argList;
+    for (size_t i = 0; i < argList->numChildren; i++) {
+        ASTNode *arg = argList->children[i];
+        if (arg->type != SYM_ARG)
+            continue;
+        _nameset_add(&defined, arg->children[0]->tok->lexeme);
+        _nameset_add(&locals, arg->children[0]->tok->lexeme);
+    }
+    _memo_collectLocals(fnRef->fnBlk, &locals);
+
+    int pure = _memo_walk(fnRef->fnBlk, &defined, &locals, global);
+    mem_free(defined.names);
+    mem_free(locals.names);
+    return pure;
+}
+
+int memo_isPure(FunctionRef *fnRef, Context *global)
+{
+    FnMemo *memo = fnRef->memo;
+    if (memo->epoch != memo_epoch) {
+        // The global bindings changed, so both the analysis and the cached results may be stale
+        _memo_flush(memo);
+        memo->purity = PURITY_UNKNOWN;
+        memo->epoch = memo_epoch;
+    }
+
+    // A function that is still being analysed is assumed pure, which is verified at the end of the round
+    if (memo->purity == PURITY_ANALYSING)
+        return 1;
+    if (memo->purity != PURITY_UNKNOWN)
+        return memo->purity == PURITY_PURE;
+
+    memoRoundCount++;
+    memoRound = mem_realloc(memoRound, sizeof(FnMemo *) * memoRoundCount);
+    memoRound[memoRoundCount - 1] = memo;
+    memoRoundDepth++;
+
+    memo->purity = PURITY_ANALYSING;
+    memo->purity = _memo_analyse(fnRef, global) ? PURITY_PURE : PURITY_IMPURE;
+
+    memoRoundDepth--;
+    if (memoRoundDepth == 0) {
+        // If a function of this round is impure, other functions may have been wrongly assumed pure,
+        // so undecide them. Impure results never rely on an assumption, so they are kept.
+        int anyImpure = 0;
+        for (size_t i = 0; i < memoRoundCount; i++)
+            if (memoRound[i]->purity == PURITY_IMPURE)
+                anyImpure = 1;
+        if (anyImpure) {
+            for (size_t i = 0; i < memoRoundCount; i++)
+                if (memoRound[i]->purity == PURITY_PURE)
+                    memoRound[i]->purity = PURITY_UNKNOWN;
+        }
+        memoRoundCount = 0;
+
+        if (memo->purity == PURITY_UNKNOWN)
+            return memo_isPure(fnRef, global);
+    }
+    return memo->purity == PURITY_PURE;
+}
+
+// Returns 1 if the value can be part of a cache key or result.
+int _memo_isCacheable(ExecValue *val)
+{
+    return val->type == TYPE_NUMBER || val->type == TYPE_STRING || val->type == TYPE_NULL;
+}
+
+// Returns 1 if both values are identical. Numbers are compared bitwise, so that 0 and -0 are different keys.
+int _memo_valueEq(ExecValue *v1, ExecValue *v2)
+{
+    if (v1->type != v2->type)
+        return 0;
+    switch (v1->type) {
+    case TYPE_NUMBER: {
+        double d1 = value_toDouble(v1), d2 = value_toDouble(v2);
+        return memcmp(&d1, &d2, sizeof(double)) == 0;
+    }
+    case TYPE_STRING: return stringref_equal(v1->value.string_ref, v2->value.string_ref);
+    case TYPE_NULL: return 1;
+    default: return 0;
+    }
+}
+
+// FNV-1a step over the type and bytes of one argument.
+size_t _memo_hashArg(size_t hash, ValueType type, const void *bytes, size_t len)
+{
+    hash = (hash ^ type) * 1099511628211UL;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ ((const unsigned char *) bytes)[i]) * 1099511628211UL;
+    return hash;
+}
+
+size_t _memo_hash(Context *fnCtx)
+{
+    size_t hash = 14695981039346656037UL;
+    for (size_t i = 0; i < fnCtx->argCount; i++) {
+        ExecValue *arg = fnCtx->symbols[i]->value;
+        if (arg->type == TYPE_NUMBER) {
+            // Hashed as a double, the same way as the arguments of memo_lookupNumbers()
+            double num = value_toDouble(arg);
+            hash = _memo_hashArg(hash, arg->type, &num, sizeof(double));
+        }
+        else if (arg->type == TYPE_STRING)
+            hash = _memo_hashArg(hash, arg->type, value_str(arg), arg->value.string_ref->length);
+        else
+            hash = _memo_hashArg(hash, arg->type, NULL, 0);
+    }
+    return hash;
+}
+
+size_t _memo_hashNumbers(double *args, size_t argCount)
+{
+    size_t hash = 14695981039346656037UL;
+    for (size_t i = 0; i < argCount; i++)
+        hash = _memo_hashArg(hash, TYPE_NUMBER, &args[i], sizeof(double));
+    return hash;
+}
+
+// Returns 1 if every argument bound in the function context can be used as a key.
+int _memo_isKeyable(Context *fnCtx)
+{
+    for (size_t i = 0; i < fnCtx->argCount; i++)
+        if (!_memo_isCacheable(fnCtx->symbols[i]->value))
+            return 0;
+    return 1;
+}
+
+// Returns the emptied entry for a hash, ready to be filled with `argCount` arguments.
+MemoEntry *_memo_replaceEntry(FnMemo *memo, size_t hash, size_t argCount)
+{
+    if (memo->entries == NULL)
+        memo->entries = mem_calloc(MEMO_CACHE_SIZE, sizeof(MemoEntry));
+
+    MemoEntry *entry = &memo->entries[hash % MEMO_CACHE_SIZE];
+    if (entry->result != NULL) {
+        for (size_t i = 0; i < entry->argCount; i++)
+            value_free(entry->args[i]);
+        mem_free(entry->args);
+        value_free(entry->result);
+    }
+    entry->argCount = argCount;
+    entry->args = mem_alloc(sizeof(ExecValue *) * argCount);
+    return entry;
+}
+
+ExecValue *memo_lookup(FnMemo *memo, Context *fnCtx)
+{
+    if (!_memo_isKeyable(fnCtx))
+        return NULL;
+    if (memo->entries != NULL) {
+        MemoEntry *entry = &memo->entries[_memo_hash(fnCtx) % MEMO_CACHE_SIZE];
+        int match = entry->result != NULL && entry->argCount == fnCtx->argCount;
+        for (size_t i = 0; match && i < entry->argCount; i++)
+            match = _memo_valueEq(entry->args[i], fnCtx->symbols[i]->value);
+        if (match) {
+            memo->hits++;
+            memoHits++;
+            return value_clone(entry->result);
+        }
+    }
+    memo->misses++;
+    memoMisses++;
+    return NULL;
+}
+
+void memo_store(FnMemo *memo, Context *fnCtx, ExecValue *result)
+{
+    if (!_memo_isKeyable(fnCtx) || !_memo_isCacheable(result))
+        return;
+
+    MemoEntry *entry = _memo_replaceEntry(memo, _memo_hash(fnCtx), fnCtx->argCount);
+    for (size_t i = 0; i < entry->argCount; i++)
+        entry->args[i] = value_clone(fnCtx->symbols[i]->value);
+    entry->result = value_clone(result);
+}
+
+int memo_lookupNumbers(FnMemo *memo, double *args, size_t argCount, double *result)
+{
+    if (memo->entries != NULL) {
+        MemoEntry *entry = &memo->entries[_memo_hashNumbers(args, argCount) % MEMO_CACHE_SIZE];
+        int match = entry->result != NULL && entry->result->type == TYPE_NUMBER && entry->argCount == argCount;
+        for (size_t i = 0; match && i < argCount; i++) {
+            double arg = entry->args[i]->type == TYPE_NUMBER ? value_toDouble(entry->args[i]) : 0;
+            match = entry->args[i]->type == TYPE_NUMBER && memcmp(&arg, &args[i], sizeof(double)) == 0;
+        }
+        if (match) {
+            memo->hits++;
+            memoHits++;
+            *result = value_toDouble(entry->result);
+            return 1;
+        }
+    }
+    memo->misses++;
+    memoMisses++;
+    return 0;
+}
+
+void memo_storeNumbers(FnMemo *memo, double *args, size_t argCount, double result)
+{
+    MemoEntry *entry = _memo_replaceEntry(memo, _memo_hashNumbers(args, argCount), argCount);
+    for (size_t i = 0; i < argCount; i++)
+        entry->args[i] = value_newNumber(args[i]);
+    entry->result = value_newNumber(result);
+}
+
+void memo_report()
+{
+    int header = 0;
+    for (FnMemo *memo = memoList; memo != NULL; memo = memo->next) {
+        if (memo->hits + memo->misses == 0)
+            continue;
+        if (!header) {
+            log_message(&executionLogger, "\n--- MEMO REPORT ---\n");
+            header = 1;
+        }
+        log_message(&executionLogger, "%s: %lu hits, %lu misses\n", memo->name ? memo->name : "<anonymous>", memo->hits, memo->misses);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef _MEMO_H_
+#define _MEMO_H_
+#include <stdlib.h>
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+
+// Number of entries in a function's result cache. The cache is direct-mapped, so a colliding entry replaces the old one.
+#define MEMO_CACHE_SIZE 1024
+
+typedef enum {
+    PURITY_UNKNOWN,
+    PURITY_ANALYSING,
+    PURITY_PURE,
+    PURITY_IMPURE,
+} Purity;
+
+// A cached result for one set of argument values.
+typedef struct {
+    size_t argCount;
+    ExecValue **args;
+    ExecValue *result;
+} MemoEntry;
+
+// Purity analysis and result cache of a function, shared by every clone of the function value.
+typedef struct _fnmemo {
+    char *name;           // Name the function was first called by, used for reporting
+    Purity purity;
+    size_t epoch;         // Value of memo_epoch when the purity was decided
+    MemoEntry *entries;   // MEMO_CACHE_SIZE entries, allocated on the first insertion
+    size_t hits;
+    size_t misses;
+    struct _fnmemo *prev, *next;
+} FnMemo;
+
+// Incremented whenever a global binding to a function changes, which invalidates every purity result and cache.
+extern size_t memo_epoch;
+
+// Cache hits and misses of every function so far, for --stats.
+extern size_t memoHits;
+extern size_t memoMisses;
+
+FnMemo *memo_new();
+void memo_free(FnMemo *memo);
+
+// Returns 1 if the function is pure: it does not print, reads no globals, and only calls pure global functions.
+int memo_isPure(FunctionRef *fnRef, Context *global);
+
+// Returns a NEW ExecValue with the cached result for the arguments bound in `fnCtx`, or NULL on a miss.
+ExecValue *memo_lookup(FnMemo *memo, Context *fnCtx);
+
+// Keeps a reference to `result` as the result for the arguments bound in `fnCtx`.
+void memo_store(FnMemo *memo, Context *fnCtx, ExecValue *result);
+
+// Same as memo_lookup, for unboxed arguments from the numeric tier. Returns 1 and sets `result` on a hit.
+int memo_lookupNumbers(FnMemo *memo, double *args, size_t argCount, double *result);
+
+// Same as memo_store, for unboxed arguments from the numeric tier.
+void memo_storeNumbers(FnMemo *memo, double *args, size_t argCount, double result);
+
+// Logs the hit/miss counters of every function that went through its cache.
+void memo_report();
+
+#endif
@@ -0,0 +1,504 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lexer/token.h"
+#include "../memory/allocator.h"
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+#include "memo.h"
+#include "numeric.h"
+
+typedef enum {
+    NUM_RESULT_OK,
+    NUM_RESULT_NULL,  // The function returned null
+    NUM_RESULT_DEOPT, // The call has to be run by the interpreter
+} NumResult;
+
+// Jumps that still have to be patched with the end of a loop.
+typedef struct {
+    size_t condStart;
+    size_t *breaks;
+    size_t breakCount;
+} NumLoop;
+
+typedef struct {
+    NumFn *fn;
+    Context *global;
+    char **slotNames;       // Name of each slot
+    char **defined;         // Variables that are definitely assigned at this point of the function
+    size_t definedCount;
+    NumLoop *loops;         // Enclosing while loops, innermost last
+    size_t loopCount;
+    size_t depth;           // Current stack depth
+} NumCompiler;
+
+void numeric_free(NumFn *fn)
+{
+    mem_free(fn->code);
+    mem_free(fn->callees);
+    mem_free(fn);
+}
+
+int _numeric_findName(char **names, size_t count, char *name)
+{
+    for (size_t i = 0; i < count; i++)
+        if (strcmp(names[i], name) == 0)
+            return (int) i;
+    return -1;
+}
+
+// Returns the slot of a variable, adding it if it's new.
+size_t _numeric_slot(NumCompiler *c, char *name)
+{
+    int slot = _numeric_findName(c->slotNames, c->fn->slotCount, name);
+    if (slot >= 0)
+        return slot;
+    c->fn->slotCount++;
+    c->slotNames = mem_realloc(c->slotNames, sizeof(char *) * c->fn->slotCount);
+    c->slotNames[c->fn->slotCount - 1] = name;
+    return c->fn->slotCount - 1;
+}
+
+void _numeric_define(NumCompiler *c, char *name)
+{
+    c->definedCount++;
+    c->defined = mem_realloc(c->defined, sizeof(char *) * c->definedCount);
+    c->defined[c->definedCount - 1] = name;
+}
+
+// Appends an instruction and returns its index.
+size_t _numeric_emit(NumCompiler *c, NumOp op, size_t arg, size_t arg2, double num)
+{
+    NumFn *fn = c->fn;
+    fn->codeLen++;
+    fn->code = mem_realloc(fn->code, sizeof(NumInstr) * fn->codeLen);
+    fn->code[fn->codeLen - 1] = (NumInstr) {op, arg, arg2, num};
+
+    switch (op) {
+    case NUM_CONST: case NUM_LOAD:
+        c->depth++;
+        break;
+    case NUM_CALL:
+        c->depth = c->depth - arg2 + 1;
+        break;
+    case NUM_NEG: case NUM_NOT: case NUM_JUMP: case NUM_RET_NULL:
+        break;
+    default:
+        c->depth--;
+        break;
+    }
+    if (c->depth > fn->maxStack)
+        fn->maxStack = c->depth;
+    return fn->codeLen - 1;
+}
+
+NumFn *_numeric_compile(FunctionRef *fnRef, Context *global);
+int _numeric_expr(NumCompiler *c, ASTNode *node);
+
+// Returns the number of parameters of a function, or -1 if a parameter has a default value.
+int _numeric_paramCount(FunctionRef *fnRef)
+{
+    int count = 0;
+    for (size_t i = 0; i < fnRef->argList->numChildren; i++) {
+        ASTNode *arg = fnRef->argList->children[i];
+        if (arg->type != SYM_ARG)
+            continue;
+        if (arg->numChildren != 1)
+            return -1;
+        count++;
+    }
+    return count;
+}
+
+int _numeric_call(NumCompiler *c, ASTNode *fnCall)
+{
+    // The callee must be a global function, which a local can't shadow
+    char *name = fnCall->children[0]->tok->lexeme;
+    if (_numeric_findName(c->slotNames, c->fn->slotCount, name) >= 0)
+        return 0;
+    ExecValue identifier = {TYPE_IDENTIFIER, .value.identifier_name = name};
+    ExecSymbol *sym = context_getSymbol(c->global, &identifier);
+    if (sym == NULL || sym->value->type != TYPE_FUNCTION)
+        return 0;
+    FunctionRef *callee = sym->value->value.function_ref;
+
+    size_t argc = 0;
+    ASTNode *fnArgs = fnCall->children[2];
+    for (size_t i = 0; i < fnArgs->numChildren; i++) {
+        if (fnArgs->children[i]->type != SYM_EXPR)
+            continue;
+        if (!_numeric_expr(c, fnArgs->children[i]))
+            return 0;
+        argc++;
+    }
+    if (_numeric_paramCount(callee) != (int) argc)
+        return 0;
+
+    // A recursive callee is already being compiled, and only its eligibility is checked when it's called
+    if (_numeric_compile(callee, c->global) == NULL)
+        return 0;
+    if (callee->memo->name == NULL)
+        callee->memo->name = mem_strdup(name);
+
+    int idx = -1;
+    for (size_t i = 0; i < c->fn->calleeCount; i++)
+        if (c->fn->callees[i] == callee)
+            idx = (int) i;
+    if (idx < 0) {
+        c->fn->calleeCount++;
+        c->fn->callees = mem_realloc(c->fn->callees, sizeof(FunctionRef *) * c->fn->calleeCount);
+        c->fn->callees[c->fn->calleeCount - 1] = callee;
+        idx = (int) c->fn->calleeCount - 1;
+    }
+    _numeric_emit(c, NUM_CALL, idx, argc, 0);
+    return 1;
+}
+
+NumOp _numeric_binaryOp(ASTNode *node)
+{
+    if (node->type == SYM_OR_EXPR)
+        return NUM_OR;
+    if (node->type == SYM_AND_EXPR)
+        return NUM_AND;
+
+    switch (node->children[1]->tok->type) {
+    case TOKEN_PLUS:          return NUM_ADD;
+    case TOKEN_MINUS:         return NUM_SUB;
+    case TOKEN_STAR:          return NUM_MUL;
+    case TOKEN_SLASH:         return NUM_DIV;
+    case TOKEN_PERCENT:       return NUM_MOD;
+    case TOKEN_CARET:         return NUM_POW;
+    case TOKEN_EQUAL_EQUAL:   return NUM_EQ;
+    case TOKEN_BANG_EQUAL:    return NUM_NEQ;
+    case TOKEN_GREATER:       return NUM_GT;
+    case TOKEN_GREATER_EQUAL: return NUM_GEQ;
+    case TOKEN_LESS:          return NUM_LT;
+    case TOKEN_LESS_EQUAL:    return NUM_LEQ;
+    default:
+        criticalError("numeric: Unexpected binary operator.");
+    }
+    return NUM_ADD;
+}
+
+// Emits code that pushes the value of an expression. Returns 0 if it can't be computed with numbers only.
+int _numeric_expr(NumCompiler *c, ASTNode *node)
+{
+    switch (node->type) {
+    case SYM_EXPR:
+        return node->children[0]->type == SYM_OR_EXPR && _numeric_expr(c, node->children[0]);
+    case SYM_OR_EXPR:
+    case SYM_AND_EXPR:
+    case SYM_EQUALITY:
+    case SYM_COMPARISON:
+    case SYM_SUM:
+    case SYM_TERM:
+    case SYM_POWER:
+        // and/or don't short-circuit, so every binary operator evaluates both sides
+        if (node->numChildren == 1)
+            return _numeric_expr(c, node->children[0]);
+        if (!_numeric_expr(c, node->children[0]) || !_numeric_expr(c, node->children[2]))
+            return 0;
+        _numeric_emit(c, _numeric_binaryOp(node), 0, 0, 0);
+        return 1;
+    case SYM_LOG_UNARY:
+    case SYM_UNARY:
+        if (node->numChildren == 1)
+            return _numeric_expr(c, node->children[0]);
+        if (!_numeric_expr(c, node->children[1]))
+            return 0;
+        if (node->children[0]->tok->type == TOKEN_NOT)
+            _numeric_emit(c, NUM_NOT, 0, 0, 0);
+        else if (node->children[0]->tok->type == TOKEN_MINUS)
+            _numeric_emit(c, NUM_NEG, 0, 0, 0);
+        return 1;
+    case SYM_PRIMARY:
+        if (node->numChildren == 3)
+            return _numeric_expr(c, node->children[1]);
+        return _numeric_expr(c, node->children[0]);
+    case SYM_FN_CALL:
+        return _numeric_call(c, node);
+    case SYM_TERMINAL:
+        switch (node->tok->type) {
+        case TOKEN_NUMBER:
+            _numeric_emit(c, NUM_CONST, 0, 0, node->tok->literal.literal_num);
+            return 1;
+        case TOKEN_TRUE:
+            _numeric_emit(c, NUM_CONST, 0, 0, 1.0);
+            return 1;
+        case TOKEN_FALSE:
+            _numeric_emit(c, NUM_CONST, 0, 0, 0.0);
+            return 1;
+        case TOKEN_IDENTIFIER:
+            // A variable that isn't definitely assigned may resolve to a global
+            if (_numeric_findName(c->defined, c->definedCount, node->tok->lexeme) < 0)
+                return 0;
+            _numeric_emit(c, NUM_LOAD, _numeric_slot(c, node->tok->lexeme), 0, 0);
+            return 1;
+        default:
+            return 0;
+        }
+    default:
+        return 0;
+    }
+}
+
+int _numeric_block(NumCompiler *c, ASTNode *block);
+
+// Emits `cond` and `block`, then the else branch `next` if it isn't NULL.
+int _numeric_branch(NumCompiler *c, ASTNode *cond, ASTNode *block, ASTNode *next)
+{
+    if (!_numeric_expr(c, cond))
+        return 0;
+    size_t jumpFalse = _numeric_emit(c, NUM_JUMP_FALSE, 0, 0, 0);
+    if (!_numeric_block(c, block))
+        return 0;
+
+    if (next == NULL || (next->type != SYM_ELSEIF && next->type != SYM_ELSE)) {
+        c->fn->code[jumpFalse].arg = c->fn->codeLen;
+        return 1;
+    }
+    size_t jumpEnd = _numeric_emit(c, NUM_JUMP, 0, 0, 0);
+    c->fn->code[jumpFalse].arg = c->fn->codeLen;
+    int ok;
+    if (next->type == SYM_ELSE)
+        ok = _numeric_block(c, next->children[2]);
+    else
+        ok = _numeric_branch(c, next->children[2], next->children[5], next->numChildren == 7 ? next->children[6] : NULL);
+    c->fn->code[jumpEnd].arg = c->fn->codeLen;
+    return ok;
+}
+
+int _numeric_while(NumCompiler *c, ASTNode *whileStmt)
+{
+    size_t condStart = c->fn->codeLen;
+    if (!_numeric_expr(c, whileStmt->children[1]))
+        return 0;
+    size_t jumpFalse = _numeric_emit(c, NUM_JUMP_FALSE, 0, 0, 0);
+
+    c->loopCount++;
+    c->loops = mem_realloc(c->loops, sizeof(NumLoop) * c->loopCount);
+    c->loops[c->loopCount - 1] = (NumLoop) {condStart, NULL, 0};
+    int ok = _numeric_block(c, whileStmt->children[3]);
+    _numeric_emit(c, NUM_JUMP, condStart, 0, 0);
+
+    // The interpreter evaluates the condition once more before a break, which has no effect on numbers
+    NumLoop *loop = &c->loops[c->loopCount - 1];
+    c->fn->code[jumpFalse].arg = c->fn->codeLen;
+    for (size_t i = 0; i < loop->breakCount; i++)
+        c->fn->code[loop->breaks[i]].arg = c->fn->codeLen;
+    mem_free(loop->breaks);
+    c->loopCount--;
+    return ok;
+}
+
+int _numeric_stmt(NumCompiler *c, ASTNode *stmt)
+{
+    switch (stmt->type) {
+    case SYM_EXPR_STMT:
+        if (!_numeric_expr(c, stmt->children[0]))
+            return 0;
+        _numeric_emit(c, NUM_POP, 0, 0, 0);
+        return 1;
+    case SYM_IFSTMT:
+        return _numeric_branch(c, stmt->children[1], stmt->children[4], stmt->children[5]);
+    case SYM_WHILE:
+        return _numeric_while(c, stmt);
+    case SYM_BREAK: {
+        // Outside of a loop, break and continue skip every remaining line of the function
+        if (c->loopCount == 0)
+            return 0;
+        NumLoop *loop = &c->loops[c->loopCount - 1];
+        loop->breakCount++;
+        loop->breaks = mem_realloc(loop->breaks, sizeof(size_t) * loop->breakCount);
+        loop->breaks[loop->breakCount - 1] = _numeric_emit(c, NUM_JUMP, 0, 0, 0);
+        return 1;
+    }
+    case SYM_CONTINUE:
+        if (c->loopCount == 0)
+            return 0;
+        _numeric_emit(c, NUM_JUMP, c->loops[c->loopCount - 1].condStart, 0, 0);
+        return 1;
+    case SYM_RETURN:
+        // A return in a loop doesn't stop the loop, and the function returns null
+        if (c->loopCount > 0)
+            return 0;
+        if (stmt->numChildren == 2) {
+            _numeric_emit(c, NUM_RET_NULL, 0, 0, 0);
+            return 1;
+        }
+        if (!_numeric_expr(c, stmt->children[1]))
+            return 0;
+        _numeric_emit(c, NUM_RET, 0, 0, 0);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int _numeric_block(NumCompiler *c, ASTNode *block)
+{
+    // Assignments in a nested block don't dominate the lines after the block
+    size_t mark = c->definedCount;
+    for (size_t i = 0; i < block->numChildren; i++) {
+        ASTNode *line = block->children[i]->children[0];
+        if (line->type == SYM_ASMT) {
+            if (!_numeric_expr(c, line->children[2]))
+                return 0;
+            _numeric_emit(c, NUM_STORE, _numeric_slot(c, line->children[0]->tok->lexeme), 0, 0);
+            _numeric_define(c, line->children[0]->tok->lexeme);
+        } else if (!_numeric_stmt(c, line->children[0])) {
+            return 0;
+        }
+    }
+    c->definedCount = mark;
+    return 1;
+}
+
+// Adds a slot for every variable assigned anywhere under `node`.
+void _numeric_collectLocals(NumCompiler *c, ASTNode *node)
+{
+    if (node->type == SYM_ASMT)
+        _numeric_slot(c, node->children[0]->tok->lexeme);
+    for (size_t i = 0; i < node->numChildren; i++)
+        _numeric_collectLocals(c, node->children[i]);
+}
+
+// Returns the numeric code of a function, compiling it if it's missing or stale, or NULL if it's ineligible.
+NumFn *_numeric_compile(FunctionRef *fnRef, Context *global)
+{
+    if (fnRef->numeric != NULL && fnRef->numeric->epoch == memo_epoch)
+        return fnRef->numeric->eligible ? fnRef->numeric : NULL;
+    if (fnRef->numeric != NULL)
+        numeric_free(fnRef->numeric);
+
+    // Registered before compiling the body, so that recursive calls find it
+    NumFn *fn = mem_alloc(sizeof(NumFn));
+    *fn = (NumFn) {1, memo_epoch, 0, NULL, 0, 0, 0, 0, NULL, 0};
+    fnRef->numeric = fn;
+
+    NumCompiler c = {fn, global, NULL, NULL, 0, NULL, 0, 0};
+    int paramCount = _numeric_paramCount(fnRef);
+    if (paramCount >= 0) {
+        // Parameters take the first slots, in the order they're bound in the function context
+        for (size_t i = 0; i < fnRef->argList->numChildren; i++) {
+            ASTNode *arg = fnRef->argList->children[i];
+            if (arg->type != SYM_ARG)
+                continue;
+            _numeric_slot(&c, arg->children[0]->tok->lexeme);
+            _numeric_define(&c, arg->children[0]->tok->lexeme);
+        }
+        fn->paramCount = paramCount;
+        _numeric_collectLocals(&c, fnRef->fnBlk);
+        fn->eligible = _numeric_block(&c, fnRef->fnBlk);
+        _numeric_emit(&c, NUM_RET_NULL, 0, 0, 0);
+    } else {
+        fn->eligible = 0;
+    }
+    mem_free(c.slotNames);
+    mem_free(c.defined);
+    mem_free(c.loops);
+    return fn->eligible ? fn : NULL;
+}
+
+NumResult _numeric_run(NumFn *fn, double *args, Context *global, double *result)
+{
+    double slots[fn->slotCount + 1];
+    double stack[fn->maxStack + 1];
+    memcpy(slots, args, sizeof(double) * fn->paramCount);
+    size_t sp = 0;
+    size_t pc = 0;
+
+    for (;;) {
+        NumInstr *instr = &fn->code[pc++];
+        switch (instr->op) {
+        case NUM_CONST: stack[sp++] = instr->num; break;
+        case NUM_LOAD:  stack[sp++] = slots[instr->arg]; break;
+        case NUM_STORE: slots[instr->arg] = stack[--sp]; break;
+        case NUM_POP:   sp--; break;
+        case NUM_ADD: sp--; stack[sp - 1] = stack[sp - 1] + stack[sp]; break;
+        case NUM_SUB: sp--; stack[sp - 1] = stack[sp - 1] - stack[sp]; break;
+        case NUM_MUL: sp--; stack[sp - 1] = stack[sp - 1] * stack[sp]; break;
+        case NUM_DIV: sp--; stack[sp - 1] = stack[sp - 1] / stack[sp]; break;
+        case NUM_MOD: sp--; stack[sp - 1] = fmod(stack[sp - 1], stack[sp]); break;
+        case NUM_POW: sp--; stack[sp - 1] = pow(stack[sp - 1], stack[sp]); break;
+        case NUM_NEG: stack[sp - 1] = -stack[sp - 1]; break;
+        case NUM_NOT: stack[sp - 1] = !(stack[sp - 1] != 0); break;
+        case NUM_AND: sp--; stack[sp - 1] = (stack[sp - 1] != 0) && (stack[sp] != 0); break;
+        case NUM_OR:  sp--; stack[sp - 1] = (stack[sp - 1] != 0) || (stack[sp] != 0); break;
+        case NUM_EQ:  sp--; stack[sp - 1] = stack[sp - 1] == stack[sp]; break;
+        case NUM_NEQ: sp--; stack[sp - 1] = !(stack[sp - 1] == stack[sp]); break;
+        case NUM_GT:  sp--; stack[sp - 1] = stack[sp - 1] > stack[sp]; break;
+        case NUM_GEQ: sp--; stack[sp - 1] = stack[sp - 1] >= stack[sp]; break;
+        case NUM_LT:  sp--; stack[sp - 1] = stack[sp - 1] < stack[sp]; break;
+        case NUM_LEQ: sp--; stack[sp - 1] = stack[sp - 1] <= stack[sp]; break;
+        case NUM_JUMP: pc = instr->arg; break;
+        case NUM_JUMP_FALSE:
+            if (!(stack[--sp] != 0))
+                pc = instr->arg;
+            break;
+        case NUM_CALL: {
+            FunctionRef *callee = fn->callees[instr->arg];
+            size_t argc = instr->arg2;
+            double *callArgs = &stack[sp - argc];
+            double value;
+
+            int isPure = memo_isPure(callee, global);
+            if (!isPure || !memo_lookupNumbers(callee->memo, callArgs, argc, &value)) {
+                if (!callee->numeric->eligible)
+                    return NUM_RESULT_DEOPT;
+                if (_numeric_run(callee->numeric, callArgs, global, &value) != NUM_RESULT_OK)
+                    return NUM_RESULT_DEOPT;
+                if (isPure)
+                    memo_storeNumbers(callee->memo, callArgs, argc, value);
+            }
+            sp -= argc;
+            stack[sp++] = value;
+            break;
+        }
+        case NUM_RET:
+            *result = stack[--sp];
+            return NUM_RESULT_OK;
+        case NUM_RET_NULL:
+            return NUM_RESULT_NULL;
+        }
+    }
+}
+
+ExecValue *numeric_call(FunctionRef *fnRef, Context *fnCtx)
+{
+    fnRef->callCount++;
+    if (fnRef->callCount < NUMERIC_HOT_THRESHOLD)
+        return NULL;
+    if (fnRef->numeric != NULL && fnRef->numeric->epoch == memo_epoch && !fnRef->numeric->eligible)
+        return NULL;
+
+    NumFn *fn = _numeric_compile(fnRef, fnCtx->global);
+    if (fn == NULL || fn->paramCount != fnCtx->argCount)
+        return NULL;
+
+    double args[fn->paramCount + 1];
+    for (size_t i = 0; i < fn->paramCount; i++) {
+        ExecValue *arg = fnCtx->symbols[i]->value;
+        if (arg->type != TYPE_NUMBER) {
+            if (++fn->deopts >= NUMERIC_MAX_DEOPTS)
+                fn->eligible = 0;
+            return NULL;
+        }
+        args[i] = value_toDouble(arg);
+    }
+
+    double result;
+    switch (_numeric_run(fn, args, fnCtx->global, &result)) {
+    case NUM_RESULT_OK:
+        return value_newNumber(result);
+    case NUM_RESULT_NULL:
+        return value_newNull();
+    default:
+        if (++fn->deopts >= NUMERIC_MAX_DEOPTS)
+            fn->eligible = 0;
+        return NULL;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef _NUMERIC_H_
+#define _NUMERIC_H_
+#include <stdlib.h>
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+
+// Number of interpreted calls before a function is compiled to the numeric tier.
+#define NUMERIC_HOT_THRESHOLD 16
+
+// Number of deoptimisations after which a function is no longer run in the numeric tier.
+#define NUMERIC_MAX_DEOPTS 8
+
+/**
+The numeric tier runs functions whose bodies only contain numeric arithmetic, comparisons,
+if/while and calls to other such functions. All values are unboxed doubles, so no ExecValue
+is allocated while the function runs.
+
+Numeric functions have no side effects, so a deoptimisation simply abandons the call and
+lets the interpreter run it again from the start.
+ */
+
+typedef enum {
+    NUM_CONST,      // push num
+    NUM_LOAD,       // push slots[arg]
+    NUM_STORE,      // slots[arg] = pop
+    NUM_POP,
+    NUM_ADD, NUM_SUB, NUM_MUL, NUM_DIV, NUM_MOD, NUM_POW,
+    NUM_NEG, NUM_NOT, NUM_AND, NUM_OR,
+    NUM_EQ, NUM_NEQ, NUM_GT, NUM_GEQ, NUM_LT, NUM_LEQ,
+    NUM_JUMP,       // pc = arg
+    NUM_JUMP_FALSE, // pc = arg if pop is false
+    NUM_CALL,       // call callees[arg] with arg2 arguments from the stack
+    NUM_RET,        // return pop
+    NUM_RET_NULL,   // return null
+} NumOp;
+
+typedef struct {
+    NumOp op;
+    size_t arg;
+    size_t arg2;
+    double num;
+} NumInstr;
+
+typedef struct _numfn {
+    int eligible;           // 0 if the function can't run in the numeric tier
+    size_t epoch;           // Value of memo_epoch when compiled, as callees are resolved through globals
+    size_t deopts;
+    NumInstr *code;
+    size_t codeLen;
+    size_t paramCount;
+    size_t slotCount;       // Parameters, then locals
+    size_t maxStack;
+    FunctionRef **callees;
+    size_t calleeCount;
+} NumFn;
+
+void numeric_free(NumFn *fn);
+
+// Returns a NEW ExecValue with the result of running the function in the numeric tier,
+// or NULL if the function isn't hot or eligible and has to be interpreted.
+// `fnCtx` holds the bound arguments.
+ExecValue *numeric_call(FunctionRef *fnRef, Context *fnCtx);
+
+#endif
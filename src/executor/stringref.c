@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../memory/allocator.h"
+#include "stringref.h"
+
+// Interned strings by hash. Each bucket is a list linked through StringRef.nextInterned.
+StringRef *internTable[INTERN_BUCKETS];
+
+size_t stringrefLive = 0;
+
+// FNV-1a over the characters. Never 0, which marks a hash that isn't computed yet.
+size_t _stringref_hashChars(const char *chars, size_t length)
+{
+    size_t hash = 14695981039346656037UL;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char) chars[i]) * 1099511628211UL;
+    return hash != 0 ? hash : 1;
+}
+
+// Returns a NEW reference to the interned string with these characters, or NULL if there's none.
+StringRef *_stringref_findInterned(const char *chars, size_t length, size_t hash)
+{
+    for (StringRef *ref = internTable[hash % INTERN_BUCKETS]; ref != NULL; ref = ref->nextInterned)
+        if (ref->hash == hash && ref->length == length && memcmp(ref->chars, chars, length) == 0)
+            return stringref_retain(ref);
+    return NULL;
+}
+
+// Returns a NEW reference to the interned string with these characters, making it if there's none yet.
+StringRef *_stringref_intern(const char *chars, size_t length)
+{
+    size_t hash = _stringref_hashChars(chars, length);
+    StringRef *ref = _stringref_findInterned(chars, length, hash);
+    if (ref != NULL)
+        return ref;
+
+    ref = mem_allocBase(sizeof(StringRef));
+    stringrefLive++;
+    ref->refCount = 1;
+    ref->length = length;
+    ref->hash = hash;
+    memcpy(ref->data.inline_chars, chars, length);
+    ref->data.inline_chars[length] = '\0';
+    ref->chars = ref->data.inline_chars;
+    ref->nextInterned = internTable[hash % INTERN_BUCKETS];
+    internTable[hash % INTERN_BUCKETS] = ref;
+    return ref;
+}
+
+void _stringref_unintern(StringRef *ref)
+{
+    StringRef **link = &internTable[ref->hash % INTERN_BUCKETS];
+    while (*link != ref)
+        link = &(*link)->nextInterned;
+    *link = ref->nextInterned;
+}
+
+int _stringref_isInline(StringRef *ref)
+{
+    return ref->chars == ref->data.inline_chars;
+}
+
+StringRef *stringref_new(const char *chars, size_t length)
+{
+    if (length <= STRING_INLINE_LENGTH)
+        return _stringref_intern(chars, length);
+    char *copy = mem_allocBase(length + 1);
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+    return stringref_take(copy, length);
+}
+
+StringRef *stringref_take(char *chars, size_t length)
+{
+    if (length <= STRING_INLINE_LENGTH) {
+        StringRef *ref = _stringref_intern(chars, length);
+        mem_free(chars);
+        return ref;
+    }
+
+    StringRef *ref = mem_allocBase(sizeof(StringRef));
+    stringrefLive++;
+    ref->refCount = 1;
+    ref->length = length;
+    ref->hash = 0;
+    ref->chars = chars;
+    ref->nextInterned = NULL;
+    return ref;
+}
+
+StringRef *stringref_concat(StringRef *left, StringRef *right)
+{
+    size_t length = left->length + right->length;
+    if (length <= STRING_INLINE_LENGTH) {
+        char chars[STRING_INLINE_LENGTH + 1];
+        memcpy(chars, stringref_chars(left), left->length);
+        memcpy(chars + left->length, stringref_chars(right), right->length);
+        return _stringref_intern(chars, length);
+    }
+    if (length < ROPE_MIN_LENGTH) {
+        char *chars = mem_allocBase(length + 1);
+        memcpy(chars, stringref_chars(left), left->length);
+        memcpy(chars + left->length, stringref_chars(right), right->length);
+        chars[length] = '\0';
+        return stringref_take(chars, length);
+    }
+
+    StringRef *ref = mem_allocBase(sizeof(StringRef));
+    stringrefLive++;
+    ref->refCount = 1;
+    ref->length = length;
+    ref->hash = 0;
+    ref->chars = NULL;
+    ref->data.rope.left = stringref_retain(left);
+    ref->data.rope.right = stringref_retain(right);
+    ref->nextInterned = NULL;
+    return ref;
+}
+
+char *stringref_chars(StringRef *ref)
+{
+    if (ref->chars != NULL)
+        return ref->chars;
+
+    // Ropes built in a loop are as deep as they are long, so they're walked with a stack instead of recursion
+    char *chars = mem_allocBase(ref->length + 1);
+    size_t pos = 0;
+    size_t capacity = 16, depth = 0;
+    StringRef **stack = mem_alloc(sizeof(StringRef *) * capacity);
+    stack[depth++] = ref;
+    while (depth > 0) {
+        StringRef *node = stack[--depth];
+        if (node->chars != NULL) {
+            memcpy(chars + pos, node->chars, node->length);
+            pos += node->length;
+            continue;
+        }
+        if (depth + 2 > capacity) {
+            capacity *= 2;
+            stack = mem_realloc(stack, sizeof(StringRef *) * capacity);
+        }
+        stack[depth++] = node->data.rope.right;
+        stack[depth++] = node->data.rope.left;
+    }
+    mem_free(stack);
+    chars[pos] = '\0';
+
+    StringRef *left = ref->data.rope.left, *right = ref->data.rope.right;
+    ref->chars = chars;
+    stringref_release(left);
+    stringref_release(right);
+    return chars;
+}
+
+StringRef *stringref_retain(StringRef *ref)
+{
+    ref->refCount++;
+    return ref;
+}
+
+void stringref_release(StringRef *ref)
+{
+    size_t capacity = 16, depth = 0;
+    StringRef **stack = NULL;
+    while (1) {
+        if (--ref->refCount == 0) {
+            // A rope that was flattened already let go of its halves
+            if (ref->chars == NULL) {
+                if (stack == NULL)
+                    stack = mem_alloc(sizeof(StringRef *) * capacity);
+                if (depth + 2 > capacity) {
+                    capacity *= 2;
+                    stack = mem_realloc(stack, sizeof(StringRef *) * capacity);
+                }
+                stack[depth++] = ref->data.rope.left;
+                stack[depth++] = ref->data.rope.right;
+            }
+            if (_stringref_isInline(ref))
+                _stringref_unintern(ref);
+            else
+                mem_free(ref->chars);
+            mem_free(ref);
+            stringrefLive--;
+        }
+        if (depth == 0)
+            break;
+        ref = stack[--depth];
+    }
+    mem_free(stack);
+}
+
+size_t stringref_hash(StringRef *ref)
+{
+    if (ref->hash == 0)
+        ref->hash = _stringref_hashChars(stringref_chars(ref), ref->length);
+    return ref->hash;
+}
+
+int stringref_equal(StringRef *a, StringRef *b)
+{
+    if (a == b)
+        return 1;
+    // Equal short strings are the same StringRef, and strings with different hashes can't be equal
+    if (a->length != b->length || a->length <= STRING_INLINE_LENGTH || stringref_hash(a) != stringref_hash(b))
+        return 0;
+    return memcmp(stringref_chars(a), stringref_chars(b), a->length) == 0;
+}
+
+int stringref_compare(StringRef *a, StringRef *b)
+{
+    if (a == b)
+        return 0;
+    size_t length = a->length < b->length ? a->length : b->length;
+    int comparison = memcmp(stringref_chars(a), stringref_chars(b), length);
+    if (comparison != 0)
+        return comparison;
+    return (a->length > b->length) - (a->length < b->length);
+}
@@ -0,0 +1,70 @@
+#ifndef _STRINGREF_H_
+#define _STRINGREF_H_
+#include <stddef.h>
+
+// Concatenations shorter than this are copied right away, longer ones are kept as ropes.
+#define ROPE_MIN_LENGTH 64
+
+// Strings up to this length keep their characters inside the StringRef, and are interned: there's only one
+// StringRef with the same characters.
+#define STRING_INLINE_LENGTH 15
+#define INTERN_BUCKETS 1024
+
+// StringRefs made and not released yet.
+extern size_t stringrefLive;
+
+/**
+The characters of a string value. String literals, and the values, variables, arguments and results that come
+from them, share the same StringRef. It's never changed once made, except to flatten it, so it's never copied
+either: the operations that change a string make a new one. A concatenation is kept as a rope of its two halves, so building a string
+piece by piece doesn't copy it each time. A rope is flattened into contiguous characters the first time they're
+needed, and the flat copy is kept.
+
+A StringRef knows its length, and keeps its hash once it's computed. Short strings are stored inline, so they
+take a single allocation, and are interned, so a short string that already exists takes none. Two of them are
+equal only if they're the same StringRef. Comparing strings of different lengths or hashes doesn't
+look at their characters.
+ */
+typedef struct _stringref {
+    size_t refCount;
+    size_t length;
+    char *chars;                // Contiguous characters, or NULL while the string is a rope
+    union {
+        struct {
+            struct _stringref *left;    // Halves of a rope, until it's flattened
+            struct _stringref *right;
+        } rope;
+        char inline_chars[STRING_INLINE_LENGTH + 1];   // `chars` of a short string
+    } data;
+    size_t hash;                // Hash of the characters, or 0 until stringref_hash() computes it
+    struct _stringref *nextInterned;
+} StringRef;
+
+// Returns a NEW StringRef with a copy of the first `length` characters of `chars`.
+StringRef *stringref_new(const char *chars, size_t length);
+
+// Returns a NEW StringRef that owns `chars`, a null-terminated buffer from mem_allocBase() with `length` characters.
+StringRef *stringref_take(char *chars, size_t length);
+
+// Returns a NEW StringRef with `left` followed by `right`. Both are shared, not copied.
+StringRef *stringref_concat(StringRef *left, StringRef *right);
+
+// Returns the null-terminated characters of `ref`, flattening it if it's a rope.
+char *stringref_chars(StringRef *ref);
+
+// Adds a reference to `ref`, and returns it.
+StringRef *stringref_retain(StringRef *ref);
+
+// Drops a reference to `ref`, freeing it and the ropes under it that aren't used anymore.
+void stringref_release(StringRef *ref);
+
+// Returns the hash of the characters of `ref`, computing it the first time.
+size_t stringref_hash(StringRef *ref);
+
+// Returns 1 if `a` and `b` have the same characters.
+int stringref_equal(StringRef *a, StringRef *b);
+
+// Returns a negative number, 0 or a positive number if `a` sorts before, the same as or after `b`, like strcmp().
+int stringref_compare(StringRef *a, StringRef *b);
+
+#endif
@@ -3,18 +3,22 @@
 #include <string.h>
 #include <math.h>
 #include "../logger/logger.h"
+#include "../memory/allocator.h"
 #include "../error/error.h"
 #include "execvalue.h"
 #include "executor.h"
 #include "symboltable.h"
+#include "memo.h"
+
+Pool symbolPool = POOL_INIT("ExecSymbol", ExecSymbol);
 
 Context *context_new(Context *parent, Context *global)
 {
-    Context *ctx = malloc(sizeof(Context));
+    Context *ctx = mem_alloc(sizeof(Context));
     ctx->global = global;
     ctx->parent = parent;
     ctx->argCount = 0;
-    ctx->symbols = malloc(0);
+    ctx->symbols = mem_alloc(0);
     ctx->symbolCount = 0;
     ctx->hasBreakOrContinue = 0;
     ctx->hasReturn = 0;
@@ -23,19 +27,20 @@ Context *context_new(Context *parent, Context *global)
 
 void context_addSymbol(Context *ctx, ExecValue *identifier)
 {
-    ExecSymbol *sym = malloc(sizeof(ExecSymbol));
+    ExecSymbol *sym = pool_alloc(&symbolPool);
     if (identifier->type != TYPE_IDENTIFIER) {
         log_message(&executionLogger, "Tried to add an ExecSymbol with an 'identifier' of type %s, expected TYPE_IDENTIFIER.\n", ValueTypeString[identifier->type]);
         exit(1);
     }
 	
     char *identifierName = identifier->value.identifier_name;
-    sym->symbolName = strdup(identifierName);
-    sym->value = malloc(sizeof(ExecValue));
+    sym->symbolName = mem_strdup(identifierName);
+    sym->value = pool_alloc(&valuePool);
     sym->value->type = TYPE_UNASSIGNED;
+    sym->value->refCount = 1;
 
     ctx->symbolCount = ctx->symbolCount + 1;
-    ctx->symbols = realloc(ctx->symbols, ctx->symbolCount * sizeof(ExecSymbol *));
+    ctx->symbols = mem_realloc(ctx->symbols, ctx->symbolCount * sizeof(ExecSymbol *));
     ctx->symbols[ctx->symbolCount-1] = sym;
 }
 
@@ -80,6 +85,10 @@ void context_setSymbol(Context *ctx, ExecValue *identifier, ExecValue *value)
         exit(1);
     }
 
+    // Rebinding a global function invalidates the purity analysis of its callers
+    if (ctx->global == NULL && (sym->value->type == TYPE_FUNCTION || value->type == TYPE_FUNCTION))
+        memo_epoch++;
+
     // Define a new ExecValue -- this is to allow the given value to be deallocated later
     ExecValue *newValue = value_clone(value);
 
@@ -90,10 +99,13 @@ void context_setSymbol(Context *ctx, ExecValue *identifier, ExecValue *value)
 
 void context_free(Context *ctx)
 {
-    for (size_t i = 0; i < ctx->symbolCount; i++)
-        free(ctx->symbols[i]);
-    free(ctx->symbols);
-    free(ctx);
+    for (size_t i = 0; i < ctx->symbolCount; i++) {
+        mem_free(ctx->symbols[i]->symbolName);
+        value_free(ctx->symbols[i]->value);
+        pool_free(&symbolPool, ctx->symbols[i]);
+    }
+    mem_free(ctx->symbols);
+    mem_free(ctx);
 }
 
 
@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../logger/logger.h"
+#include "../memory/allocator.h"
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+#include "typeinfer.h"
+
+#define T_NUM TYPES_OF(TYPE_NUMBER)
+#define T_STR TYPES_OF(TYPE_STRING)
+
+// Expression nodes typed, the ones with a single type, and the binary nodes specialized.
+size_t typedNodes = 0;
+size_t monoNodes = 0;
+size_t specializedNodes = 0;
+
+// The types of a variable at some point of the program. The names are not owned.
+typedef struct {
+    char *name;
+    unsigned int types;
+} TypeBinding;
+
+// The variables with known types. A variable that isn't in it can have any type.
+typedef struct {
+    TypeBinding *bindings;
+    size_t count;
+    size_t capacity;
+} TypeEnv;
+
+unsigned int _typeenv_get(TypeEnv *env, char *name)
+{
+    for (size_t i = 0; i < env->count; i++)
+        if (strcmp(env->bindings[i].name, name) == 0)
+            return env->bindings[i].types;
+    return TYPES_ANY;
+}
+
+void _typeenv_set(TypeEnv *env, char *name, unsigned int types)
+{
+    for (size_t i = 0; i < env->count; i++) {
+        if (strcmp(env->bindings[i].name, name) == 0) {
+            env->bindings[i].types = types;
+            return;
+        }
+    }
+    if (env->count == env->capacity) {
+        env->capacity = env->capacity == 0 ? 16 : env->capacity * 2;
+        env->bindings = mem_realloc(env->bindings, sizeof(TypeBinding) * env->capacity);
+    }
+    env->bindings[env->count++] = (TypeBinding) {name, types};
+}
+
+TypeEnv _typeenv_copy(TypeEnv *env)
+{
+    TypeEnv copy = {mem_alloc(sizeof(TypeBinding) * (env->count + 1)), env->count, env->count + 1};
+    if (env->count > 0)
+        memcpy(copy.bindings, env->bindings, sizeof(TypeBinding) * env->count);
+    return copy;
+}
+
+// Frees `env` and replaces it with `with`.
+void _typeenv_replace(TypeEnv *env, TypeEnv with)
+{
+    mem_free(env->bindings);
+    *env = with;
+}
+
+// Adds the types of `other` to `env`, for a point that can be reached from both. Returns 1 if `env` changed.
+int _typeenv_join(TypeEnv *env, TypeEnv *other)
+{
+    int changed = 0;
+    for (size_t i = 0; i < env->count; i++) {
+        unsigned int types = env->bindings[i].types | _typeenv_get(other, env->bindings[i].name);
+        if (types != env->bindings[i].types)
+            changed = 1;
+        env->bindings[i].types = types;
+    }
+    return changed;
+}
+
+// Returns the types of `op` applied to values of types `l` and `r`, following the value_op* functions.
+unsigned int _typeinfer_binary(TokenType op, unsigned int l, unsigned int r)
+{
+    unsigned int types = 0;
+    switch (op) {
+    case TOKEN_PLUS:
+        if ((l & T_NUM) && (r & T_NUM))
+            types |= T_NUM;
+        if (((l & T_STR) && (r & (T_STR | T_NUM))) || ((l & T_NUM) && (r & T_STR)))
+            types |= T_STR;
+        return types;
+    case TOKEN_MINUS:
+        if ((l & T_NUM) && (r & T_NUM))
+            types |= T_NUM;
+        if ((l & T_STR) && (r & T_STR))
+            types |= T_STR;
+        return types;
+    case TOKEN_STAR: case TOKEN_SLASH:
+        if ((l & T_NUM) && (r & T_NUM))
+            types |= T_NUM;
+        if ((l & T_STR) && (r & T_NUM))
+            types |= T_STR;
+        return types;
+    default:
+        // Logical operators, comparisons, %, ^
+        return T_NUM;
+    }
+}
+
+unsigned int _typeinfer_expr(ASTNode *node, TypeEnv *env)
+{
+    unsigned int types = TYPES_ANY;
+    switch (node->type) {
+    case SYM_TERMINAL:
+        switch (node->tok->type) {
+        case TOKEN_NUMBER: case TOKEN_TRUE: case TOKEN_FALSE: types = T_NUM; break;
+        case TOKEN_STRING:     types = T_STR; break;
+        case TOKEN_NULL:       types = TYPES_OF(TYPE_NULL); break;
+        case TOKEN_IDENTIFIER: types = _typeenv_get(env, node->tok->lexeme); break;
+        default: break;
+        }
+        break;
+    case SYM_FN_EXPR:
+        types = TYPES_OF(TYPE_FUNCTION);
+        break;
+    case SYM_FN_CALL:
+        // The callee can return anything, but its arguments are expressions of this scope
+        for (size_t i = 0; i < node->rhs->numChildren; i++)
+            if (node->rhs->children[i]->type == SYM_EXPR)
+                _typeinfer_expr(node->rhs->children[i]->lhs, env);
+        break;
+    case SYM_LOG_UNARY: case SYM_UNARY: {
+        if (node->rhs == NULL) {
+            types = _typeinfer_expr(node->lhs, env);
+            break;
+        }
+        unsigned int r = _typeinfer_expr(node->rhs, env);
+        // Unary + gives back numbers and functions as they are
+        types = node->op == TOKEN_PLUS ? r & (T_NUM | TYPES_OF(TYPE_FUNCTION)) : T_NUM;
+        break;
+    }
+    case SYM_OR_EXPR: case SYM_AND_EXPR: case SYM_EQUALITY: case SYM_COMPARISON:
+    case SYM_SUM: case SYM_TERM: case SYM_POWER: case SYM_EXPR: case SYM_PRIMARY: {
+        if (node->rhs == NULL) {
+            types = _typeinfer_expr(node->lhs, env);
+            break;
+        }
+        unsigned int l = _typeinfer_expr(node->lhs, env);
+        unsigned int r = _typeinfer_expr(node->rhs, env);
+        types = _typeinfer_binary(node->op, l, r);
+        break;
+    }
+    default:
+        break;
+    }
+    node->types = types;
+    return types;
+}
+
+void _typeinfer_block(ASTNode *block, TypeEnv *env);
+
+void _typeinfer_else(ASTNode *node, TypeEnv *env)
+{
+    if (node->type == SYM_ELSE) {
+        _typeinfer_block(node->lhs, env);
+    } else if (node->type == SYM_ELSEIF) {
+        _typeinfer_expr(node->lhs, env);
+        TypeEnv thenEnv = _typeenv_copy(env);
+        _typeinfer_block(node->rhs, &thenEnv);
+        if (node->numChildren == 7)
+            _typeinfer_else(node->children[6], env);
+        _typeenv_join(env, &thenEnv);
+        mem_free(thenEnv.bindings);
+    }
+}
+
+void _typeinfer_stmt(ASTNode *stmt, TypeEnv *env)
+{
+    switch (stmt->type) {
+    case SYM_ASMT:
+        _typeenv_set(env, stmt->lhs->tok->lexeme, _typeinfer_expr(stmt->rhs, env));
+        break;
+    case SYM_EXPR_STMT: case SYM_PRNT_STMT: case SYM_RETURN:
+        if (stmt->lhs != NULL)
+            _typeinfer_expr(stmt->lhs, env);
+        break;
+    case SYM_IFSTMT: {
+        _typeinfer_expr(stmt->lhs, env);
+        TypeEnv thenEnv = _typeenv_copy(env);
+        _typeinfer_block(stmt->rhs, &thenEnv);
+        _typeinfer_else(stmt->children[5], env);
+        _typeenv_join(env, &thenEnv);
+        mem_free(thenEnv.bindings);
+        break;
+    }
+    case SYM_WHILE: {
+        // The types at the condition grow with every pass over the body, until they stay the same.
+        // The last pass typed the body with all of them.
+        int changed = 1;
+        while (changed) {
+            _typeinfer_expr(stmt->lhs, env);
+            TypeEnv bodyEnv = _typeenv_copy(env);
+            _typeinfer_block(stmt->rhs, &bodyEnv);
+            changed = _typeenv_join(env, &bodyEnv);
+            mem_free(bodyEnv.bindings);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// A block can be left after any of its lines, by break, continue or return, so the types after it are the ones
+// after any of its lines.
+void _typeinfer_block(ASTNode *block, TypeEnv *env)
+{
+    TypeEnv out = {NULL, 0, 0};
+    int first = 1;
+    for (size_t i = 0; i < block->numChildren; i++) {
+        ASTNode *line = block->children[i];
+        if (line->type != SYM_LINE)
+            continue;
+        _typeinfer_stmt(line->lhs, env);
+        if (first)
+            out = _typeenv_copy(env);
+        else
+            _typeenv_join(&out, env);
+        first = 0;
+    }
+    if (!first)
+        _typeenv_replace(env, out);
+}
+
+// Counts the typed nodes under `node`, and links the binary nodes with single-typed operands to a specialized evaluator.
+void _typeinfer_specialize(ASTNode *node)
+{
+    if (node->type == SYM_FN_EXPR)
+        return;
+    for (size_t i = 0; i < node->numChildren; i++)
+        _typeinfer_specialize(node->children[i]);
+
+    if (node->types == 0 || node->eval == NULL)
+        return;
+    typedNodes++;
+    if ((node->types & (node->types - 1)) == 0)
+        monoNodes++;
+
+    // Fused nodes already run on numbers without the type checks
+    if (node->eval != execBinary && node->eval != execQuickBinary)
+        return;
+    unsigned int l = node->lhs->types, r = node->rhs->types;
+    if (l == T_NUM && r == T_NUM && node->op != TOKEN_OR && node->op != TOKEN_AND) {
+        node->eval = execTypedNumber;
+        specializedNodes++;
+    } else if (l == T_STR && r == T_STR && node->op == TOKEN_PLUS) {
+        node->eval = execTypedConcat;
+        specializedNodes++;
+    }
+}
+
+void typeinfer_analyze(ASTNode *node)
+{
+    if (node->type != SYM_START && node->type != SYM_BLOCK)
+        return;
+
+    TypeEnv env = {NULL, 0, 0};
+    _typeinfer_block(node, &env);
+    mem_free(env.bindings);
+    _typeinfer_specialize(node);
+}
+
+void typeinfer_report()
+{
+    if (typedNodes == 0)
+        return;
+    log_message(&executionLogger, "\n--- TYPE REPORT ---\n");
+    log_message(&executionLogger, "%lu of %lu typed nodes monomorphic (%.1f%%), %lu binary nodes specialized\n",
+                monoNodes, typedNodes, 100.0 * monoNodes / typedNodes, specializedNodes);
+}
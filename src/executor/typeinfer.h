@@ -0,0 +1,31 @@
+#ifndef _TYPEINFER_H_
+#define _TYPEINFER_H_
+#include "../parser/symbol.h"
+#include "execvalue.h"
+#include "executor.h"
+#include "symboltable.h"
+
+/**
+Static type inference. typeinfer_analyze() follows the statements of a lowered tree in order, keeping the types
+each variable can have, and sets ASTNode.types on every expression node to the types its value can have once
+identifiers are looked up. A variable the tree doesn't assign, like a global read from a function or a variable
+from an earlier REPL line, can have any type. Errors aren't part of a type set, because they stop the statement.
+
+A binary node whose operands each have a single type runs with an evaluator specialized to those types, which
+skips the type checks of the value_op* functions.
+ */
+
+// The bit of `type` in a type set.
+#define TYPES_OF(type) (1u << (type))
+
+// Types a variable can hold.
+#define TYPES_ANY (TYPES_OF(TYPE_NUMBER) | TYPES_OF(TYPE_STRING) | TYPES_OF(TYPE_NULL) | TYPES_OF(TYPE_FUNCTION))
+
+// Infers the types of the expressions under `node`, which must already be lowered, and specializes binary nodes.
+// Function bodies are analyzed when they're lowered as function values.
+void typeinfer_analyze(ASTNode *node);
+
+// Logs how many expression nodes were typed, and the share of them with a single type.
+void typeinfer_report();
+
+#endif
@@ -57,6 +57,19 @@ void reportError(const char *msg)
     log_message(&executionLogger, "%s\n", msg);
 }
 
+// Stops with a critical error if the parser built a tree the executor can't trust.
+void verifyTree(ASTNode *root)
+{
+    const char *reason;
+    ASTNode *invalid = astnode_verify(root, &reason);
+    if (invalid == NULL)
+        return;
+
+    char msg[MAX_ERRMSG_LEN];
+    snprintf(msg, MAX_ERRMSG_LEN, "verify: %s: %s", SymbolTypeString[invalid->type], reason);
+    criticalError(msg);
+}
+
 // Returns true if expecting more input
 int runLine(const char *source, Context *executionContext, int asREPL)
 {
@@ -71,17 +84,27 @@ int runLine(const char *source, Context *executionContext, int asREPL)
     LexResult lexResult;
     ExecValue *val;
     Error *parseError;
+    Region region;
+    State phase;
+    StatsMark mark;
+    double traceStart;
+    int expectingMore = 0;
 
     initFSM(&fsm);
     while (fsm.current_state != CLEANING) {
+        phase = fsm.current_state;
+        mark = stats_begin();
+        traceStart = trace_now();
         switch (fsm.current_state) {
             case INIT:
-                // 0. Initialisation
+                // 0. Initialisation. Everything until the execution is allocated in the region of the run.
+                region_init(&region);
+                region_enter(&region);
                 success = 1;
                 tokenCount = 0;
                 errorCount = 0;
-                tokens = malloc(sizeof(Token *) * 0);
-                errors = malloc(sizeof(Error *) * 0);
+                tokens = mem_alloc(sizeof(Token *) * 0);
+                errors = mem_alloc(sizeof(Error *) * 0);
                 root = astnode_new(SYM_START, NULL);
                 initLexResult(&lexResult);
 
@@ -97,6 +120,7 @@ int runLine(const char *source, Context *executionContext, int asREPL)
                 log_message(&executionLogger, "Token Count: %lu\n", tokenCount);
                 for (size_t i = 0; i < tokenCount; i++)
                     token_print(tokens[i]);
+                stats.tokens += tokenCount;
 
                 transition(&fsm, !lexResult.hasError);
                 break;
@@ -112,7 +136,6 @@ int runLine(const char *source, Context *executionContext, int asREPL)
                         reportError(errStr);
                         error_free(errors[i]);
                     }
-                    free(errors);
                 }
 
                 transition(&fsm, success);
@@ -124,44 +147,60 @@ int runLine(const char *source, Context *executionContext, int asREPL)
                 log_message(&executionLogger, "\n");
 
                 if (parseError != NULL) {
-                    if (parseError->type == ERR_SYNTAX_EOF && asREPL) {
-                        // Only ask for more input if this is in REPL mode.
-                        error_free(parseError);
-                        astnode_free(root);
-                        return 1;
-                    }
-
                     transition(&fsm, !success);
                     break;
                 }
 
                 log_message(&executionLogger, "\n--- AST ---\n");
+                if (stats.format != STATS_OFF)
+                    stats.parseNodes += astnode_count(root);
                 astnode_gen(root);
+                if (stats.format != STATS_OFF)
+                    stats.astNodes += astnode_count(root);
+                verifyTree(root);
+                fusion_annotate(root);
+                execLower(root);
                 astnode_print(root);
                 log_message(&executionLogger, "\n");
                 transition(&fsm, success);
                 break;
             case PARSING_ERROR:
-                error_string(parseError, errStr, MAX_ERRSTR_LEN);
-                reportError(errStr);
+                if (parseError->type == ERR_SYNTAX_EOF && asREPL) {
+                    // Only ask for more input if this is in REPL mode.
+                    expectingMore = 1;
+                } else {
+                    error_string(parseError, errStr, MAX_ERRSTR_LEN);
+                    reportError(errStr);
+                }
+                error_free(parseError);
 
                 transition(&fsm, success);
                 break;
             case EXECUTING:
+                // Values and function bodies can outlive the run, so they're not made in its region
+                region_exit(&region);
                 log_message(&executionLogger, "\n--- EXECUTION RESULT ---\n");
                 val = execStart(executionContext, root);
+                memo_report();
+                fusion_report();
+                typeinfer_report();
+                pool_report();
+                allocator_report();
 
                 if (val->type == TYPE_ERROR) {
+                    region_enter(&region);
                     transition(&fsm, !success);
                     break;
                 }
                 value_free(val);
 
+                region_enter(&region);
                 transition(&fsm, success);
                 break;
             case EXECUTING_ERROR:
                 error_string(val->value.error_ptr, errStr, MAX_ERRSTR_LEN);
                 reportError(errStr);
+                trace_error(val->value.error_ptr, errStr);
                 value_free(val);
 
                 transition(&fsm, success);
@@ -169,21 +208,28 @@ int runLine(const char *source, Context *executionContext, int asREPL)
             default:
                 break;
         }
+        stats_end(phase, StateString[phase], mark);
+        trace_span(StateString[phase], "phase", traceStart, -1);
     }
 
     if (fsm.current_state == CLEANING) {
-        // 4. Clean up
+        // 4. Clean up. Tokens and nodes hold pooled objects and strings, the rest of the run goes with its region.
+        mark = stats_begin();
+        traceStart = trace_now();
         astnode_free(root);
         for (size_t i = 0; i < tokenCount; i++)
             token_free(tokens[i]);
-        free(tokens);
-        free(errorContext);
-        errorContext = NULL;
+        freeErrorContext();
+        region_exit(&region);
+        region_release(&region);
+        stats_end(CLEANING, StateString[CLEANING], mark);
+        trace_span(StateString[CLEANING], "phase", traceStart, -1);
     }
-    return 0;
+    return expectingMore;
 }
 
-void runFile(const char* fname)
+// Returns a NEW string with the contents of a file.
+char *readSource(const char *fname)
 {
     FILE *srcFile = fopen(fname, "r");
     long fileSz = 0;
@@ -199,7 +245,7 @@ void runFile(const char* fname)
     fseek(srcFile, 0, SEEK_SET);
 
     // Allocate space for file's contents
-    source = malloc((fileSz * sizeof(char)) + 1);
+    source = mem_alloc((fileSz * sizeof(char)) + 1);
     if (source == NULL) {
         fprintf(stderr, "Error allocating memory for file %s: %s\n", fname, strerror(errno));
         exit(errno);
@@ -209,10 +255,110 @@ void runFile(const char* fname)
     size_t totalSz = fread(source, sizeof(char), fileSz, srcFile);
     source[totalSz] = '\0';
     fclose(srcFile);
+    return source;
+}
+
+#ifdef MS_PARANOID
+// Paranoid builds check that nothing a run made outlives its global context.
+void checkTeardown()
+{
+    char msg[MAX_ERRMSG_LEN] = "teardown: still live:";
+    size_t live = 0;
+    for (Pool *pool = pools; pool != NULL; pool = pool->next) {
+        if (pool->live == 0)
+            continue;
+        size_t len = strlen(msg);
+        snprintf(msg + len, MAX_ERRMSG_LEN - len, " %lu %s", pool->live, pool->name);
+        live += pool->live;
+    }
+    if (stringrefLive > 0) {
+        size_t len = strlen(msg);
+        snprintf(msg + len, MAX_ERRMSG_LEN - len, " %lu strings", stringrefLive);
+        live += stringrefLive;
+    }
+    if (live > 0)
+        criticalError(msg);
+}
+#endif
+
+void runFile(const char* fname)
+{
+    char *source = readSource(fname);
 
     // Run the entire file.
     Context *globalCtx = context_new(NULL, NULL);
     runLine(source, globalCtx, 0);
+    context_free(globalCtx);
+    mem_free(source);
+#ifdef MS_PARANOID
+    checkTeardown();
+#endif
+}
+
+int emitFile(const char *fname)
+{
+    char *source = readSource(fname);
+    size_t tokenCount = 0;
+    size_t errorCount = 0;
+    Token **tokens = mem_alloc(sizeof(Token *) * 0);
+    Error **errors = mem_alloc(sizeof(Error *) * 0);
+    ASTNode *root = astnode_new(SYM_START, NULL);
+    LexResult lexResult;
+    char errStr[MAX_ERRSTR_LEN];
+    char *code = NULL;
+
+    initLexResult(&lexResult);
+    initErrorContext(source);
+    lex((const Token ***) &tokens, &tokenCount, source, &lexResult);
+    if (lexResult.hasError) {
+        lexError(lexResult.errorMessage, lexResult.lineNum, lexResult.colNum, (const Error ***) &errors, &errorCount);
+    } else {
+        Error *parseError = parse(root, tokens, tokenCount);
+        if (parseError != NULL) {
+            errorCount = 1;
+            errors = mem_realloc(errors, sizeof(Error *));
+            errors[0] = parseError;
+        } else {
+            astnode_gen(root);
+            verifyTree(root);
+            code = transpile(root, source, &errors, &errorCount);
+        }
+    }
+
+    for (size_t i = 0; i < errorCount; i++) {
+        error_string(errors[i], errStr, MAX_ERRSTR_LEN);
+        reportError(errStr);
+        error_free(errors[i]);
+    }
+
+    // script.ms is written to script.c
+    if (code != NULL) {
+        size_t nameLen = strlen(fname);
+        if (nameLen > 3 && strcmp(fname + nameLen - 3, ".ms") == 0)
+            nameLen -= 3;
+        char *outName = mem_alloc(nameLen + 3);
+        snprintf(outName, nameLen + 3, "%.*s.c", (int) nameLen, fname);
+
+        FILE *outFile = fopen(outName, "w");
+        if (outFile == NULL) {
+            fprintf(stderr, "Error opening %s: %s\n", outName, strerror(errno));
+            exit(errno);
+        }
+        fputs(code, outFile);
+        fclose(outFile);
+        log_message(&consoleLogger, "Wrote %s\n", outName);
+        mem_free(outName);
+        mem_free(code);
+    }
+
+    astnode_free(root);
+    for (size_t i = 0; i < tokenCount; i++)
+        token_free(tokens[i]);
+    mem_free(tokens);
+    mem_free(errors);
+    freeErrorContext();
+    mem_free(source);
+    return errorCount == 0;
 }
 
 void runREPL()
@@ -252,4 +398,5 @@ void runREPL()
             log_message(&executionLogger, "\n\n");
         }
     }
+    context_free(globalCtx);
 }
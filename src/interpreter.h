@@ -12,6 +12,16 @@
 #include "parser/parser.h"
 #include "executor/executor.h"
 #include "executor/symboltable.h"
+#include "executor/memo.h"
+#include "executor/fusion.h"
+#include "executor/typeinfer.h"
+#include "memory/allocator.h"
+#include "memory/pool.h"
+#include "memory/region.h"
+#include "stats/profile.h"
+#include "stats/stats.h"
+#include "stats/trace.h"
+#include "transpiler/transpiler.h"
 #define REPL_BUF_MAX 2000
 #define LINE_MAX 1000
 
@@ -26,14 +36,28 @@ typedef enum {
     CLEANING,
 } State;
 
+static const char *StateString[] = {
+    "INIT",
+    "LEXING",
+    "PARSING",
+    "EXECUTING",
+    "LEXING_ERROR",
+    "PARSING_ERROR",
+    "EXECUTING_ERROR",
+    "CLEANING",
+};
+
 typedef struct {
     State current_state;
 } FSM;
 
 void transition(FSM *fsm, int success);
 void initFSM(FSM *fsm);
+void verifyTree(ASTNode *root);
 int runLine(const char *source, Context *executionContext, int asREPL);
 void runFile(const char* fname);
+// Translates a file to C with transpile(), written next to it. Returns 0 if it couldn't be translated.
+int emitFile(const char *fname);
 void runREPL();
 
 #endif
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../error/error.h"
+#include "../memory/allocator.h"
 #include "token.h"
 #include "lexer.h"
 
@@ -23,12 +24,12 @@ void lexResultUpdate(LexResult *lexResult, int hasError, const char *errStr, int
 
 void lexError(const char *errStr, int lineNum, int colNum, const Error ***errorsPtr, size_t *errorCount)
 {
-    Error *err = error_new(ERR_TOKEN, lineNum, colNum);
-    sprintf(err->message, "%s", errStr);
+    Error *err = error_new(ERR_TOKEN, MSG_TEXT, lineNum, colNum);
+    error_withText(err, errStr);
 
     // Add Error to list
     *errorCount = *errorCount + 1;
-    *errorsPtr = realloc(*errorsPtr, sizeof(Error *) * (*errorCount));
+    *errorsPtr = mem_realloc(*errorsPtr, sizeof(Error *) * (*errorCount));
     (*errorsPtr)[*(errorCount) - 1] = err;
 }
 
@@ -154,11 +155,23 @@ size_t lexNumber(const char *source, size_t srcLen, size_t lexStart, size_t *err
     return lexEnd;
 }
 
+// Makes room for `count` more tokens, doubling the capacity of the list when it's full.
+void lexReserve(const Token ***tokensPtr, size_t tokenCount, size_t *capacity, size_t count)
+{
+    if (tokenCount + count <= *capacity)
+        return;
+    while (tokenCount + count > *capacity)
+        *capacity = *capacity < 16 ? 16 : *capacity * 2;
+    *tokensPtr = mem_realloc(*tokensPtr, sizeof(Token *) * (*capacity));
+}
+
 void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexResult *lexResult){
     size_t srcLen = strlen(source);
+    size_t capacity = *tokenCount;
+    // Columns are offsets from the start of the current line, which is recorded in the error context's line index
     int lineNum = 0;
-    int colNum = 0;
-    char *errMsg;
+    size_t lineStart = 0;
+    char errMsg[MAX_ERRMSG_LEN];
     size_t errLen = 0;
 
     size_t lexStart = 0;  // Start of the lexeme
@@ -167,7 +180,6 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
         TokenType tokType = TOKEN_UNKNOWN;
         char lookahead = *(source + lexStart);
         char lookahead2 = (lexStart >= srcLen) ? '\0' : *(source + lexStart + 1);
-        errMsg = calloc(MAX_ERRMSG_LEN, sizeof(char));
         errLen = 0;
         lexEnd = lexStart;
 
@@ -179,11 +191,11 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
 
             // Iterate until end of string
             // We want lexStart to be at the first ", and lexEnd to be AFTER the next ".
-            lexEnd++; colNum++;
+            lexEnd++;
             for (size_t i = lexStart + 1; *(source + i) != '"'; i++) {
                 if (*(source + i) == '\n' || *(source + i) == '\0')
                     break;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
 
             // INVARIANT: lexEnd either points to the next ", or
@@ -191,11 +203,11 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
             if (*(source + lexEnd) == '\n' || *(source + lexEnd) == '\0') {
                 tokType = TOKEN_UNKNOWN;
                 sprintf(errMsg, "Unterminated string");
-                lexResultUpdate(lexResult, 1, errMsg, lineNum, colNum);
+                lexResultUpdate(lexResult, 1, errMsg, lineNum, lexEnd - lineStart);
                 lexEnd = srcLen;
             } else {
                 // make lexEnd point to the character AFTER the end quotes.
-                lexEnd += 1; colNum += 1; 
+                lexEnd += 1;
             }
             break;
         }
@@ -203,30 +215,30 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
             // Possible: +, +=
             if (lookahead2 == '=') {
                 tokType = TOKEN_PLUS_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_PLUS;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '-':
             // Possible: -, -=
             if (lookahead2 == '=') {
                 tokType = TOKEN_MINUS_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_MINUS;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '*':
             // Possible: *, *=
             if (lookahead2 == '=') {
                 tokType = TOKEN_STAR_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_STAR;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '/':
@@ -234,143 +246,142 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
             if (lookahead2 == '=') {
                 tokType = TOKEN_SLASH_EQUAL;
                 lexEnd += 2;
-                colNum += 2;
             } else if (lookahead2 == '/') {
                 // Comment
                 for (int i = lexStart + 1; *(source + i) != '\n' && *(source + i) != '\0'; i++)
-                    lexEnd++; colNum++;
+                    lexEnd++;
                 // INVARIANT: Now lexEnd points at the newline/EOF character.
-                lexEnd++; colNum++;
+                lexEnd++;
             } else {
                 tokType = TOKEN_SLASH;
                 lexEnd++;
-                colNum++;
             }
             break;
         case '%':
             // Possible: %, %=
             if (lookahead2 == '=') {
                 tokType = TOKEN_PERCENT_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_PERCENT;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '^':
             // Possible: ^, ^=
             if (lookahead2 == '=') {
                 tokType = TOKEN_CARET_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_CARET;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case ':':
             tokType = TOKEN_COLON;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '.':
             // Possible: ., Number starting with .
             if (isDigit(lookahead2)) {
                 tokType = TOKEN_NUMBER;
                 lexEnd = lexNumber(source, srcLen, lexStart, &errLen, errMsg);
-                colNum += lexEnd - lexStart;
                 if (errLen > 0) {
                     tokType = TOKEN_UNKNOWN;
-                    lexResultUpdate(lexResult, 1, errMsg, lineNum, colNum);
+                    lexResultUpdate(lexResult, 1, errMsg, lineNum, lexEnd - lineStart);
                 }
             } else {
                 tokType = TOKEN_PERIOD;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case ',':
             tokType = TOKEN_COMMA;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '=':
             // Possible: =, ==
             if (lookahead2 == '=') {
                 tokType = TOKEN_EQUAL_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_EQUAL;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '@':
             tokType = TOKEN_AT;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '!':
             // Possible: !=
             if (lookahead2 == '=') {
                 tokType = TOKEN_BANG_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 // Unknown
                 tokType = TOKEN_UNKNOWN;
                 sprintf(errMsg, "Unexpected character %c", lookahead);
-                lexResultUpdate(lexResult, 1, errMsg, lineNum, colNum);
-                lexEnd++; colNum++;
+                lexResultUpdate(lexResult, 1, errMsg, lineNum, lexEnd - lineStart);
+                lexEnd++;
             }
             break;
         case '>':
             // Possible: >, >=
             if (lookahead2 == '=') {
                 tokType = TOKEN_GREATER_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_GREATER;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '<':
             // Possible: <, <=
             if (lookahead2 == '=') {
                 tokType = TOKEN_LESS_EQUAL;
-                lexEnd += 2; colNum += 2;
+                lexEnd += 2;
             } else {
                 tokType = TOKEN_LESS;
-                lexEnd++; colNum++;
+                lexEnd++;
             }
             break;
         case '(':
             tokType = TOKEN_PAREN_L;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case ')':
             tokType = TOKEN_PAREN_R;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '[':
             tokType = TOKEN_BRACK_L;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case ']':
             tokType = TOKEN_BRACK_R;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '{':
             tokType = TOKEN_BRACE_L;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '}':
             tokType = TOKEN_BRACE_R;
-            lexEnd++; colNum++;
+            lexEnd++;
             break;
         case '\n':
             tokType = TOKEN_NL;
-            lineNum++; colNum = 0;
+            lineNum++;
             lexEnd++;
+            lineStart = lexEnd;
+            error_addLine(lineStart);
             break;
         default:
             if (isAlpha(lookahead)) {
                 // Possible: Keyword, Identifier
                 for (size_t i = lexStart; isAlphaDigit(*(source + i)); i++) {
-                    lexEnd++; colNum++;
+                    lexEnd++;
                 }
                 size_t kwLen = lexEnd - lexStart;
                 tokType = matchKeywordOrIdentifier(source + lexStart, kwLen);
@@ -378,20 +389,19 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
                 // Possible: Literal Number
                 tokType = TOKEN_NUMBER;
                 lexEnd = lexNumber(source, srcLen, lexStart, &errLen, errMsg);
-                colNum += lexEnd - lexStart;  // lexEnd and lexStart on same line, so colNum would be still correct
                 if (errLen > 0) {
                     tokType = TOKEN_UNKNOWN;
-                    lexResultUpdate(lexResult, 1, errMsg, lineNum, colNum);
+                    lexResultUpdate(lexResult, 1, errMsg, lineNum, lexEnd - lineStart);
                 }
             } else if (lookahead == ' ' || lookahead == '\t' || lookahead == '\r') {
                 // Whitespace, ignore 
-                lexEnd++; colNum++;
+                lexEnd++;
             } else {
                 // Unknown
                 tokType = TOKEN_UNKNOWN;
                 sprintf(errMsg, "Unexpected character %c", lookahead);
-                lexResultUpdate(lexResult, 1, errMsg, lineNum, colNum);
-                lexEnd++; colNum++;
+                lexResultUpdate(lexResult, 1, errMsg, lineNum, lexEnd - lineStart);
+                lexEnd++;
             }
         }
 
@@ -400,25 +410,24 @@ void lex(const Token ***tokensPtr, size_t *tokenCount, const char *source, LexRe
             size_t lexemeLen = lexEnd - lexStart;
 
             // Add Token to list
+            lexReserve(tokensPtr, *tokenCount, &capacity, 1);
             *tokenCount = *tokenCount + 1;
-            *tokensPtr = realloc(*tokensPtr, sizeof(Token *) * (*tokenCount));
-            (*tokensPtr)[*(tokenCount) - 1] = token_new(tokType, source + lexStart, lexemeLen, lineNum, colNum);
+            (*tokensPtr)[*(tokenCount) - 1] = token_new(tokType, source + lexStart, lexemeLen, lineNum, lexEnd - lineStart);
         }
         lexStart = lexEnd;
-        free(errMsg);
     }
 
     // Add NL token, if it doesn't already end with one
     
     if (*tokenCount > 0 && (*tokensPtr)[*(tokenCount) - 1]->type != TOKEN_NL) {
+        lexReserve(tokensPtr, *tokenCount, &capacity, 2);
         *tokenCount += 2;
-        *tokensPtr = realloc(*tokensPtr, sizeof(Token *) * (*tokenCount));
-        lineNum += 1; colNum = 0;
-        (*tokensPtr)[*(tokenCount) - 2] = token_new(TOKEN_NL, "\n", 1, lineNum, colNum);
-        lineNum += 1; colNum = 0;
+        lineNum += 1;
+        (*tokensPtr)[*(tokenCount) - 2] = token_new(TOKEN_NL, "\n", 1, lineNum, 0);
+        lineNum += 1;
     } else {
+        lexReserve(tokensPtr, *tokenCount, &capacity, 1);
         *tokenCount += 1;
-        *tokensPtr = realloc(*tokensPtr, sizeof(Token *) * (*tokenCount));
     }
 
     // Add EOF token
@@ -3,16 +3,20 @@
 #include <stdbool.h>
 #include <string.h>
 #include "../logger/logger.h"
+#include "../memory/allocator.h"
+#include "../memory/pool.h"
 #include "token.h"
 
+Pool tokenPool = POOL_INIT("Token", Token);
+
 Token* token_new(TokenType type, const char* lexeme, const int lexemeLength, int lineNum, int colNum)
 {
-    Token *ret = malloc(sizeof(Token));
+    Token *ret = pool_alloc(&tokenPool);
 
     // Create a null-terminated copy of the lexeme to be saved
     char *lexeme_cpy = NULL;
     if (lexeme != NULL) {
-        lexeme_cpy = malloc((lexemeLength + 1) * sizeof(char));
+        lexeme_cpy = mem_alloc((lexemeLength + 1) * sizeof(char));
         memcpy(lexeme_cpy, lexeme, lexemeLength);
         lexeme_cpy[lexemeLength] = '\0';
     }
@@ -23,9 +27,8 @@ Token* token_new(TokenType type, const char* lexeme, const int lexemeLength, int
         Token tok = {type, lexeme_cpy, .literal.literal_num=literal_num, lineNum, colNum};
         memcpy(ret, &tok, sizeof(Token));
     } else if (type == TOKEN_STRING) {
-        char *literal_str = malloc((lexemeLength - 1) * sizeof(char));
-        strncpy(literal_str, lexeme_cpy + 1, lexemeLength - 2);
-        literal_str[lexemeLength-2] = '\0';
+        // The literal is the lexeme without its quotes
+        StringRef *literal_str = stringref_new(lexeme_cpy + 1, lexemeLength - 2);
         Token tok = {type, lexeme_cpy, .literal.literal_str = literal_str, lineNum, colNum};
         memcpy(ret, &tok, sizeof(Token));
     } else {
@@ -37,6 +40,13 @@ Token* token_new(TokenType type, const char* lexeme, const int lexemeLength, int
 
 Token *token_clone(Token *tok)
 {
+    if (tok->type == TOKEN_STRING) {
+        Token *ret = pool_alloc(&tokenPool);
+        Token clone = {tok->type, mem_strdup(tok->lexeme), .literal.literal_str = stringref_retain(tok->literal.literal_str), tok->lineNum, tok->colNum};
+        memcpy(ret, &clone, sizeof(Token));
+        return ret;
+    }
+
     size_t lexLen = 0;
     if (tok->lexeme != NULL)
         lexLen = strlen(tok->lexeme);
@@ -78,6 +88,8 @@ void token_string(char *str, const Token *token)
 void token_free(Token *token)
 {
     if (token->lexeme != NULL)
-        free(token->lexeme);
-    free(token);
+        mem_free(token->lexeme);
+    if (token->type == TOKEN_STRING)
+        stringref_release(token->literal.literal_str);
+    pool_free(&tokenPool, token);
 }
@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #ifndef _TOKEN_H_
 #define _TOKEN_H_
+#include "../executor/stringref.h"
 #define MAX_LEXEME_SIZE 255
 
 typedef enum {
@@ -78,7 +79,7 @@ typedef struct {
     {
         void* literal_null;
         double literal_num;
-        char* literal_str;
+        StringRef* literal_str; // Shared with the string values evaluated from the token
     } literal;
     const int lineNum;
     const int colNum;
@@ -86,7 +87,7 @@ typedef struct {
 
 // Generates a new token. If the token type is a literal, the literal will be automatically generated. If the token is a literal number and exceeds the range for a double, errno will be set to ERANGE.
 Token* token_new(TokenType type, const char* lexeme, const int lexemeLength, int lineNum, int colNum);
-// Clones a token entirely.
+// Clones a token entirely. A string literal is shared with the clone.
 Token *token_clone(Token* token);
 // Frees the memory associated with the token
 void token_free(Token* token); 
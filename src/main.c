@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "logger/logger.h"
 #include "interpreter.h"
 
@@ -6,12 +7,58 @@ int main(int argc, char **argv)
 {
     init_loggers();
 
-    if (argc == 1)
+    // Options come before the file. The allocator is picked before anything is allocated.
+    while (argc >= 3) {
+        if (strcmp(argv[1], "--alloc") == 0) {
+            Allocator *alloc = allocator_find(argv[2]);
+            if (alloc == NULL) {
+                log_message(&consoleLogger, "Unknown allocator %s, expected system, arena or tracking\n", argv[2]);
+                cleanup_loggers();
+                return 1;
+            }
+            allocator_use(alloc);
+        } else if (strcmp(argv[1], "--stats") == 0) {
+            if (!stats_enable(argv[2])) {
+                log_message(&consoleLogger, "Unknown stats format %s, expected text or json\n", argv[2]);
+                cleanup_loggers();
+                return 1;
+            }
+        } else if (strcmp(argv[1], "--trace") == 0) {
+            if (!trace_open(argv[2])) {
+                log_message(&consoleLogger, "Error opening %s: %s\n", argv[2], strerror(errno));
+                cleanup_loggers();
+                return 1;
+            }
+        } else if (strcmp(argv[1], "--profile") == 0) {
+            if (!profile_open(argv[2])) {
+                log_message(&consoleLogger, "Error opening %s: %s\n", argv[2], strerror(errno));
+                cleanup_loggers();
+                return 1;
+            }
+        } else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc == 1) {
         runREPL();
-    else if (argc == 2)
+        stats_report();
+        trace_close();
+        profile_close();
+    } else if (argc == 2) {
         runFile(argv[1]);
-    else {
-        log_message(&consoleLogger, "Usage: ./miniscript [file]\n");
+        stats_report();
+        trace_close();
+        profile_close();
+    } else if (argc == 3 && strcmp(argv[1], "--emit-c") == 0) {
+        int success = emitFile(argv[2]);
+        cleanup_loggers();
+        return !success;
+    } else {
+        log_message(&consoleLogger, "Usage: ./miniscript [--alloc system|arena|tracking] [--stats text|json] [--trace out.json] [--profile out.folded] [file]\n");
+        log_message(&consoleLogger, "       ./miniscript [--alloc system|arena|tracking] --emit-c file\n");
         cleanup_loggers();
         return 1;
     }
@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../error/error.h"
+#include "../logger/logger.h"
+#include "allocator.h"
+
+// State of the arena allocator. Chunks are never freed, so they aren't kept track of.
+typedef struct {
+    char *chunk;
+    size_t used;
+    size_t capacity;
+    size_t chunkCount;
+    size_t bytes;       // Bytes handed out, headers included
+} Arena;
+
+// State of the tracking allocator.
+typedef struct {
+    size_t allocs;
+    size_t resizes;
+    size_t releases;
+    size_t bytesLive;
+    size_t bytesPeak;
+} Tracking;
+
+void *_system_alloc(Allocator *self, size_t size)
+{
+    void *ptr = malloc(size > 0 ? size : 1);
+    if (ptr == NULL)
+        criticalError("Out of memory.\n");
+    return ptr;
+}
+
+void *_system_resize(Allocator *self, void *ptr, size_t size)
+{
+    ptr = realloc(ptr, size > 0 ? size : 1);
+    if (ptr == NULL)
+        criticalError("Out of memory.\n");
+    return ptr;
+}
+
+void _system_release(Allocator *self, void *ptr)
+{
+    free(ptr);
+}
+
+size_t alloc_round(size_t size)
+{
+    return (size + ALLOC_HEADER_SIZE - 1) / ALLOC_HEADER_SIZE * ALLOC_HEADER_SIZE;
+}
+
+// The size an allocation of `ptr` was made with, kept in its header.
+size_t *_header_size(void *ptr)
+{
+    return (size_t *) ((char *) ptr - ALLOC_HEADER_SIZE);
+}
+
+void *_arena_alloc(Allocator *self, size_t size)
+{
+    Arena *arena = self->state;
+    size_t needed = ALLOC_HEADER_SIZE + alloc_round(size);
+    if (arena->chunk == NULL || arena->used + needed > arena->capacity) {
+        arena->capacity = needed > ARENA_CHUNK_SIZE ? needed : ARENA_CHUNK_SIZE;
+        arena->chunk = _system_alloc(self, arena->capacity);
+        arena->used = 0;
+        arena->chunkCount++;
+    }
+    char *ptr = arena->chunk + arena->used + ALLOC_HEADER_SIZE;
+    arena->used += needed;
+    arena->bytes += needed;
+    *_header_size(ptr) = size;
+    return ptr;
+}
+
+void *_arena_resize(Allocator *self, void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return _arena_alloc(self, size);
+    Arena *arena = self->state;
+    size_t oldSize = *_header_size(ptr);
+    // The newest allocation of the current chunk grows in place, if the chunk has room
+    char *chunkEnd = arena->chunk + arena->capacity;
+    if ((char *) ptr > arena->chunk && (char *) ptr < chunkEnd) {
+        size_t start = (char *) ptr - arena->chunk;
+        size_t oldEnd = start + alloc_round(oldSize), newEnd = start + alloc_round(size);
+        if (oldEnd == arena->used && newEnd <= arena->capacity) {
+            arena->bytes += newEnd - oldEnd;
+            arena->used = newEnd;
+            *_header_size(ptr) = size;
+            return ptr;
+        }
+    }
+
+    void *newPtr = _arena_alloc(self, size);
+    memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+    return newPtr;
+}
+
+void _arena_release(Allocator *self, void *ptr)
+{
+}
+
+void _arena_report(Allocator *self)
+{
+    Arena *arena = self->state;
+    log_message(&executionLogger, "arena: %lu bytes in %lu chunks\n", arena->bytes, arena->chunkCount);
+}
+
+void *_tracking_alloc(Allocator *self, size_t size)
+{
+    Tracking *tracking = self->state;
+    char *ptr = (char *) _system_alloc(self, ALLOC_HEADER_SIZE + size) + ALLOC_HEADER_SIZE;
+    *_header_size(ptr) = size;
+    tracking->allocs++;
+    tracking->bytesLive += size;
+    if (tracking->bytesLive > tracking->bytesPeak)
+        tracking->bytesPeak = tracking->bytesLive;
+    return ptr;
+}
+
+void *_tracking_resize(Allocator *self, void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return _tracking_alloc(self, size);
+    Tracking *tracking = self->state;
+    tracking->resizes++;
+    tracking->bytesLive -= *_header_size(ptr);
+    char *newPtr = (char *) _system_resize(self, _header_size(ptr), ALLOC_HEADER_SIZE + size) + ALLOC_HEADER_SIZE;
+    *_header_size(newPtr) = size;
+    tracking->bytesLive += size;
+    if (tracking->bytesLive > tracking->bytesPeak)
+        tracking->bytesPeak = tracking->bytesLive;
+    return newPtr;
+}
+
+void _tracking_release(Allocator *self, void *ptr)
+{
+    if (ptr == NULL)
+        return;
+    Tracking *tracking = self->state;
+    tracking->releases++;
+    tracking->bytesLive -= *_header_size(ptr);
+    free(_header_size(ptr));
+}
+
+void _tracking_report(Allocator *self)
+{
+    Tracking *tracking = self->state;
+    log_message(&executionLogger, "tracking: %lu allocs, %lu resizes, %lu frees, %lu bytes live, %lu bytes peak\n",
+                tracking->allocs, tracking->resizes, tracking->releases, tracking->bytesLive, tracking->bytesPeak);
+}
+
+Arena arenaState = {NULL, 0, 0, 0, 0};
+Tracking trackingState = {0, 0, 0, 0, 0};
+
+Allocator systemAllocator = {"system", _system_alloc, _system_resize, _system_release, NULL, NULL, NULL};
+Allocator arenaAllocator = {"arena", _arena_alloc, _arena_resize, _arena_release, _arena_report, NULL, &arenaState};
+Allocator trackingAllocator = {"tracking", _tracking_alloc, _tracking_resize, _tracking_release, _tracking_report, NULL, &trackingState};
+
+Allocator *allocator = &systemAllocator;
+Allocator *baseAllocator = &systemAllocator;
+
+Allocator *allocator_find(const char *name)
+{
+    Allocator *bundled[] = {&systemAllocator, &arenaAllocator, &trackingAllocator};
+    for (size_t i = 0; i < sizeof(bundled) / sizeof(bundled[0]); i++)
+        if (strcmp(bundled[i]->name, name) == 0)
+            return bundled[i];
+    return NULL;
+}
+
+void allocator_use(Allocator *alloc)
+{
+    allocator = alloc;
+    baseAllocator = alloc;
+}
+
+void allocator_report()
+{
+    if (baseAllocator->report == NULL)
+        return;
+    log_message(&executionLogger, "\n--- ALLOCATOR REPORT ---\n");
+    baseAllocator->report(baseAllocator);
+}
+
+void *mem_calloc(size_t count, size_t size)
+{
+    void *ptr = mem_alloc(count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+char *mem_strdup(const char *str)
+{
+    size_t size = strlen(str) + 1;
+    char *copy = mem_alloc(size);
+    memcpy(copy, str, size);
+    return copy;
+}
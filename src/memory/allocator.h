@@ -0,0 +1,83 @@
+#ifndef _ALLOCATOR_H_
+#define _ALLOCATOR_H_
+#include <stddef.h>
+
+// Size of the chunks the arena allocator bumps through. Larger allocations get a chunk of their own.
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// Every allocation of the arena and tracking allocators starts with a header this big, which keeps its size.
+#define ALLOC_HEADER_SIZE 16
+
+/**
+Where the interpreter gets its memory from. The lexer, parser, executor and transpiler allocate through mem_alloc()
+and the other mem_* functions, which go to the allocator in use. The base allocator is picked once with
+allocator_use(), before anything is allocated, so all memory is given back to the allocator it came from.
+
+The bundled allocators, by name:
+- system: malloc() and free().
+- arena: bumps a pointer through chunks of ARENA_CHUNK_SIZE, and frees nothing until the program exits.
+- tracking: malloc() and free(), counting the calls and the bytes in use.
+ */
+typedef struct _allocator {
+    const char *name;
+    void *(*alloc)(struct _allocator *self, size_t size);
+    void *(*resize)(struct _allocator *self, void *ptr, size_t size); // Like realloc(), `ptr` can be NULL
+    void (*release)(struct _allocator *self, void *ptr);             // Like free(), `ptr` can be NULL
+    void (*report)(struct _allocator *self);                         // Logs what the allocator did, can be NULL
+    int (*owns)(struct _allocator *self, const void *ptr);           // 1 if `ptr` is its memory, only regions have it
+    void *state;
+} Allocator;
+
+extern Allocator systemAllocator;
+extern Allocator arenaAllocator;
+extern Allocator trackingAllocator;
+
+// The allocator in use. It's baseAllocator, or a region entered with region_enter(), see region.h.
+extern Allocator *allocator;
+
+// The allocator picked with allocator_use(), systemAllocator by default. Memory that can outlive a region comes from it.
+extern Allocator *baseAllocator;
+
+// Returns the bundled allocator called `name`, or NULL if there's none.
+Allocator *allocator_find(const char *name);
+
+// Makes `alloc` the base allocator, and the one in use. Must be called before anything is allocated.
+void allocator_use(Allocator *alloc);
+
+// Logs what the allocator in use did, if it keeps count.
+void allocator_report();
+
+// Rounds `size` up to a multiple of ALLOC_HEADER_SIZE, so that the allocation after it is aligned too.
+size_t alloc_round(size_t size);
+
+// Returns `size` bytes from the allocator in use. Never returns NULL.
+static inline void *mem_alloc(size_t size)
+{
+    return allocator->alloc(allocator, size);
+}
+
+// Returns `size` bytes from baseAllocator, that aren't released with a region. Never returns NULL.
+static inline void *mem_allocBase(size_t size)
+{
+    return baseAllocator->alloc(baseAllocator, size);
+}
+
+// Resizes `ptr`, which can be NULL, to `size` bytes. Never returns NULL.
+static inline void *mem_realloc(void *ptr, size_t size)
+{
+    return allocator->resize(allocator, ptr, size);
+}
+
+// Gives `ptr` back to the allocator in use. Does nothing if `ptr` is NULL.
+static inline void mem_free(void *ptr)
+{
+    allocator->release(allocator, ptr);
+}
+
+// Returns `count` zeroed objects of `size` bytes.
+void *mem_calloc(size_t count, size_t size);
+
+// Returns a copy of the null-terminated `str`.
+char *mem_strdup(const char *str);
+
+#endif
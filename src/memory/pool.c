@@ -0,0 +1,45 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../error/error.h"
+#include "../logger/logger.h"
+#include "allocator.h"
+#include "pool.h"
+
+Pool *pools = NULL;
+
+void *pool_grow(Pool *pool)
+{
+    char *slab = mem_allocBase(pool->stride * POOL_SLAB_OBJECTS);
+    if (slab == NULL)
+        criticalError("pool_grow: Could not allocate a slab.\n");
+    if (pool->slabCount++ == 0) {
+        pool->next = pools;
+        pools = pool;
+    }
+    pool->bump = slab + pool->stride;
+    pool->bumpEnd = slab + pool->stride * POOL_SLAB_OBJECTS;
+    return slab;
+}
+
+void pool_free(Pool *pool, void *obj)
+{
+    if (obj == NULL || (allocator->owns != NULL && allocator->owns(allocator, obj)))
+        return;
+#ifdef MS_PARANOID
+    // Freed objects are filled with garbage, so that using one after it's freed fails early
+    memset(obj, 0xdb, pool->stride);
+#endif
+    *(void **) obj = pool->freeList;
+    pool->freeList = obj;
+    pool->live--;
+}
+
+void pool_report()
+{
+    if (pools == NULL)
+        return;
+    log_message(&executionLogger, "\n--- POOL REPORT ---\n");
+    for (Pool *pool = pools; pool != NULL; pool = pool->next)
+        log_message(&executionLogger, "%s: %lu allocated, %lu live, %lu high water, %lu slabs of %lu bytes\n", pool->name,
+                    pool->allocs, pool->live, pool->highWater, pool->slabCount, pool->stride * POOL_SLAB_OBJECTS);
+}
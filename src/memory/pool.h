@@ -0,0 +1,69 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+#include <stddef.h>
+#include "allocator.h"
+
+// Objects in each slab a pool gets from mem_allocBase().
+#define POOL_SLAB_OBJECTS 256
+
+// Objects are spaced by a multiple of this, so that any of them is aligned like malloc() memory.
+#define POOL_ALIGN 16
+
+/**
+A slab pool of objects of one fixed size. Objects are carved out of slabs of POOL_SLAB_OBJECTS, by bumping a pointer
+through the newest slab. A freed object goes on the pool's free list, linked through its first word, and is the first
+one handed out again. Slabs are never given back to the allocator, a pool only grows to its high-water mark.
+
+While a region is entered, objects come from the region instead, and go with it, see region.h.
+
+Every pool counts the objects it handed out, its live objects and their high-water mark, which pool_report() logs.
+ */
+typedef struct _pool {
+    const char *name;
+    size_t stride;          // Size of an object, rounded up to POOL_ALIGN
+    void *freeList;
+    char *bump;             // Next unused object of the newest slab
+    char *bumpEnd;
+    size_t slabCount;
+    size_t allocs;          // Objects handed out in total
+    size_t live;            // Objects handed out and not freed
+    size_t highWater;       // Most objects live at once
+    struct _pool *next;     // Pools that have a slab, for pool_report()
+} Pool;
+
+// Every pool with a slab, newest first.
+extern Pool *pools;
+
+// Initializer of the pool for objects of `type`.
+#define POOL_INIT(name, type) {(name), (sizeof(type) + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN, NULL, NULL, NULL, 0, 0, 0, 0, NULL}
+
+// Adds a slab to `pool`, and returns its first object. Only called by pool_alloc().
+void *pool_grow(Pool *pool);
+
+// Returns an uninitialized object from `pool`.
+static inline void *pool_alloc(Pool *pool)
+{
+    pool->allocs++;
+    if (allocator != baseAllocator)
+        return mem_alloc(pool->stride);
+    void *obj = pool->freeList;
+    if (obj != NULL) {
+        pool->freeList = *(void **) obj;
+    } else if (pool->bump != pool->bumpEnd) {
+        obj = pool->bump;
+        pool->bump += pool->stride;
+    } else {
+        obj = pool_grow(pool);
+    }
+    if (++pool->live > pool->highWater)
+        pool->highWater = pool->live;
+    return obj;
+}
+
+// Gives `obj` back to `pool`, which it must come from. Does nothing if `obj` is NULL.
+void pool_free(Pool *pool, void *obj);
+
+// Logs the objects handed out, live objects and high-water mark of every pool.
+void pool_report();
+
+#endif
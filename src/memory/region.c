@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "region.h"
+
+// A chunk of a region, followed by its memory.
+typedef struct _regionchunk {
+    struct _regionchunk *next;
+    size_t used;
+    size_t capacity;
+    size_t padding;         // Keeps the memory after the chunk aligned to ALLOC_HEADER_SIZE
+} RegionChunk;
+
+// An entry of the directory of a region: a chunk, and a block of REGION_CHUNK_SIZE bytes of addresses it covers.
+typedef struct _regionslot {
+    uintptr_t block;
+    RegionChunk *chunk;     // NULL if the slot is free
+} RegionSlot;
+
+// Returns 1 if `ptr` can be an allocation of `chunk`. Every allocation starts after its header, and an empty one can
+// end the chunk.
+int _region_inChunk(RegionChunk *chunk, const void *ptr)
+{
+    char *start = (char *) (chunk + 1);
+    return (char *) ptr > start && (char *) ptr <= start + chunk->capacity;
+}
+
+// Returns the first slot to look for `block` in.
+size_t _region_hash(Region *region, uintptr_t block)
+{
+    return (block * 0x9E3779B97F4A7C15u >> 17) & (region->slotCount - 1);
+}
+
+void _region_addSlot(Region *region, uintptr_t block, RegionChunk *chunk)
+{
+    size_t i = _region_hash(region, block);
+    while (region->slots[i].chunk != NULL)
+        i = (i + 1) & (region->slotCount - 1);
+    region->slots[i] = (RegionSlot) {block, chunk};
+    region->slotsUsed++;
+}
+
+// Adds `chunk` to the directory, under every block it covers. The directory doubles once it's half full.
+void _region_addChunk(Region *region, RegionChunk *chunk)
+{
+    uintptr_t first = ((uintptr_t) (chunk + 1) + 1) / REGION_CHUNK_SIZE;
+    uintptr_t last = ((uintptr_t) (chunk + 1) + chunk->capacity) / REGION_CHUNK_SIZE;
+    if (2 * (region->slotsUsed + last - first + 1) > region->slotCount) {
+        RegionSlot *old = region->slots;
+        size_t oldCount = region->slotCount;
+        region->slotCount = oldCount == 0 ? 64 : oldCount;
+        while (2 * (region->slotsUsed + last - first + 1) > region->slotCount)
+            region->slotCount *= 2;
+        region->slots = region->parent->alloc(region->parent, sizeof(RegionSlot) * region->slotCount);
+        memset(region->slots, 0, sizeof(RegionSlot) * region->slotCount);
+        region->slotsUsed = 0;
+        for (size_t i = 0; i < oldCount; i++)
+            if (old[i].chunk != NULL)
+                _region_addSlot(region, old[i].block, old[i].chunk);
+        region->parent->release(region->parent, old);
+    }
+    for (uintptr_t block = first; block <= last; block++)
+        _region_addSlot(region, block, chunk);
+}
+
+// Returns the chunk of `region` that `ptr` is in, or NULL if it isn't the region's. The directory finds it without
+// going through the chunks, since mem_free() and mem_realloc() ask for every pointer while the region is entered.
+RegionChunk *_region_chunkOf(Region *region, const void *ptr)
+{
+    if (region->slotCount == 0)
+        return NULL;
+    uintptr_t block = (uintptr_t) ptr / REGION_CHUNK_SIZE;
+    for (size_t i = _region_hash(region, block); region->slots[i].chunk != NULL; i = (i + 1) & (region->slotCount - 1))
+        if (region->slots[i].block == block && _region_inChunk(region->slots[i].chunk, ptr))
+            return region->slots[i].chunk;
+    return NULL;
+}
+
+void *_region_alloc(Allocator *self, size_t size)
+{
+    Region *region = self->state;
+    size_t needed = ALLOC_HEADER_SIZE + alloc_round(size);
+    RegionChunk *chunk = region->chunks;
+    if (chunk == NULL || chunk->used + needed > chunk->capacity) {
+        size_t capacity = needed > REGION_CHUNK_SIZE ? needed : REGION_CHUNK_SIZE;
+        chunk = region->parent->alloc(region->parent, sizeof(RegionChunk) + capacity);
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        chunk->next = region->chunks;
+        region->chunks = chunk;
+        _region_addChunk(region, chunk);
+    }
+    char *ptr = (char *) (chunk + 1) + chunk->used + ALLOC_HEADER_SIZE;
+    chunk->used += needed;
+    region->bytes += needed;
+    *(size_t *) (ptr - ALLOC_HEADER_SIZE) = size;
+    return ptr;
+}
+
+void *_region_resize(Allocator *self, void *ptr, size_t size)
+{
+    Region *region = self->state;
+    if (ptr == NULL)
+        return _region_alloc(self, size);
+    RegionChunk *chunk = _region_chunkOf(region, ptr);
+    if (chunk == NULL)
+        return region->parent->resize(region->parent, ptr, size);
+
+    // The newest allocation of a chunk grows in place, if the chunk has room
+    size_t oldSize = *(size_t *) ((char *) ptr - ALLOC_HEADER_SIZE);
+    size_t start = (char *) ptr - (char *) (chunk + 1);
+    size_t oldEnd = start + alloc_round(oldSize), newEnd = start + alloc_round(size);
+    if (oldEnd == chunk->used && newEnd <= chunk->capacity) {
+        region->bytes += newEnd - oldEnd;
+        chunk->used = newEnd;
+        *(size_t *) ((char *) ptr - ALLOC_HEADER_SIZE) = size;
+        return ptr;
+    }
+
+    void *newPtr = _region_alloc(self, size);
+    memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+    return newPtr;
+}
+
+void _region_release(Allocator *self, void *ptr)
+{
+    Region *region = self->state;
+    if (ptr != NULL && _region_chunkOf(region, ptr) == NULL)
+        region->parent->release(region->parent, ptr);
+}
+
+int _region_owns(Allocator *self, const void *ptr)
+{
+    return _region_chunkOf(self->state, ptr) != NULL;
+}
+
+void region_init(Region *region)
+{
+    region->allocator = (Allocator) {"region", _region_alloc, _region_resize, _region_release, NULL, _region_owns, region};
+    region->parent = NULL;
+    region->chunks = NULL;
+    region->slots = NULL;
+    region->slotCount = 0;
+    region->slotsUsed = 0;
+    region->bytes = 0;
+}
+
+void region_enter(Region *region)
+{
+    region->parent = allocator;
+    allocator = &region->allocator;
+}
+
+void region_exit(Region *region)
+{
+    allocator = region->parent;
+}
+
+void region_release(Region *region)
+{
+    Allocator *parent = region->parent != NULL ? region->parent : allocator;
+    while (region->chunks != NULL) {
+        RegionChunk *chunk = region->chunks;
+        region->chunks = chunk->next;
+        parent->release(parent, chunk);
+    }
+    parent->release(parent, region->slots);
+    region->slots = NULL;
+    region->slotCount = 0;
+    region->slotsUsed = 0;
+    region->bytes = 0;
+}
@@ -0,0 +1,47 @@
+#ifndef _REGION_H_
+#define _REGION_H_
+#include <stddef.h>
+#include "allocator.h"
+
+// Size of the chunks a region gets from the allocator it was entered from. Larger allocations get a chunk of their own.
+#define REGION_CHUNK_SIZE (64 * 1024)
+
+struct _regionchunk;
+struct _regionslot;
+
+/**
+Memory that's released all at once. runLine() allocates the tokens, the syntax tree, its analyses and the errors
+of a run in a region, so the paths that drop them without freeing them don't leak, and the whole lot goes back
+in one go when the run is cleaned up.
+
+While a region is entered it's the allocator in use: mem_alloc() bumps a pointer through its newest chunk, and
+mem_free() does nothing to its memory. Memory that isn't the region's is resized and freed by the allocator the
+region was entered from.
+
+Pooled objects made while a region is entered, like the tokens of the run, come from the region too. What
+outlives the run never goes in a region: pool slabs and strings come from baseAllocator, and the executor, which
+makes the values and function bodies that end up in the global Context, runs outside of the region.
+ */
+typedef struct {
+    Allocator allocator;
+    Allocator *parent;              // Allocator in use before the region was entered
+    struct _regionchunk *chunks;    // Newest first
+    struct _regionslot *slots;      // Directory of the chunks by address, a hash table of slotCount slots
+    size_t slotCount;
+    size_t slotsUsed;
+    size_t bytes;                   // Bytes handed out, headers included
+} Region;
+
+// Makes `region` an empty region.
+void region_init(Region *region);
+
+// Makes `region` the allocator in use, until region_exit().
+void region_enter(Region *region);
+
+// Puts back the allocator that was in use before region_enter().
+void region_exit(Region *region);
+
+// Frees all the memory of `region`, which must not be entered, and leaves it empty.
+void region_release(Region *region);
+
+#endif
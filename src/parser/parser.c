@@ -21,7 +21,7 @@ void printParse(char* str, Token **tokens, size_t *curIdx)
         log_message(&executionLogger, "%s: Token at index %lu, type %s, lexeme \"%s\"\n", str, *curIdx, TokenTypeString[tokens[*curIdx]->type], tokens[*curIdx]->lexeme);
 }
 
-Error *getParseError(ErrorType type, Token **tokens, size_t tokensLen, size_t *curIdx)
+Error *getParseError(ErrorType type, ErrorCode code, Token **tokens, size_t tokensLen, size_t *curIdx)
 {
     // We use the PREVIOUS token if this one is a newline
     size_t idx = *curIdx;
@@ -32,7 +32,7 @@ Error *getParseError(ErrorType type, Token **tokens, size_t tokensLen, size_t *c
             break;
         tok = getToken(tokens, tokensLen, idx);
     }
-    Error *err = error_new(type, tok->lineNum, tok->colNum);
+    Error *err = error_new(type, code, tok->lineNum, tok->colNum);
     return err;
 }
 
@@ -42,8 +42,8 @@ Error *parseTerminal(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *
     Token *tok = getToken(tokens, tokensLen, *curIdx);
 
     if (expectedTokenType != tok->type) {
-        Error *err = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-        snprintf(err->message, MAX_ERRMSG_LEN, "Expected token %s, instead got %s.", TokenTypeString[expectedTokenType], TokenTypeString[tok->type]);
+        Error *err = getParseError(ERR_SYNTAX, MSG_EXPECTED_TOKEN, tokens, tokensLen, curIdx);
+        error_withArgs(err, TokenTypeString[expectedTokenType], TokenTypeString[tok->type]);
         return err;
     }
     astnode_addChild(parent, SYM_TERMINAL, tok);
@@ -63,12 +63,11 @@ Error *parsePrimary(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *c
         Error *exprError = parseExpr(self, tokens, tokensLen, curIdx);
         Error *hasEOFError = parseTerminal(self, tokens, tokensLen, curIdx, TOKEN_PAREN_R);
         if (exprError) {
-            error_free(exprError);
+            error_free(hasEOFError);
             return exprError;
         }
         if (hasEOFError) {
-            Error *eofError = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);     
-            snprintf(eofError->message, MAX_ERRMSG_LEN, "Expected a closing parentheses.");
+            Error *eofError = getParseError(ERR_SYNTAX, MSG_EXPECTED_PAREN_R, tokens, tokensLen, curIdx);
             error_free(hasEOFError);
             return eofError;
         }
@@ -96,8 +95,8 @@ Error *parsePrimary(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *c
         break;
     }
     default: {
-        Error *err = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-        snprintf(err->message, MAX_ERRMSG_LEN, "Expecting either a terminal or a starting parentheses, instead got token %s.", TokenTypeString[lookahead->type]);
+        Error *err = getParseError(ERR_SYNTAX, MSG_EXPECTED_TERMINAL, tokens, tokensLen, curIdx);
+        error_withArgs(err, TokenTypeString[lookahead->type], NULL);
         return err;
     }
     }
@@ -114,8 +113,7 @@ Error *parseFnCall(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     Token *lookahead2 = getToken(tokens, tokensLen, *curIdx + 1);
     Error *err = NULL;
     if (lookahead->type != TOKEN_IDENTIFIER || lookahead2->type != TOKEN_PAREN_L) {
-        err = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-        snprintf(err->message, MAX_ERRMSG_LEN, "Expecting a function call.");
+        err = getParseError(ERR_SYNTAX, MSG_EXPECTED_CALL, tokens, tokensLen, curIdx);
         astnode_free(self);
         return err;
     }
@@ -128,8 +126,7 @@ Error *parseFnCall(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     }
     lookahead = getToken(tokens, tokensLen, *curIdx);
     if (lookahead->type != TOKEN_PAREN_R) {
-        err = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-        snprintf(err->message, MAX_ERRMSG_LEN, "Expected function call to end with right parentheses.");
+        err = getParseError(ERR_SYNTAX, MSG_CALL_END, tokens, tokensLen, curIdx);
         astnode_free(self);
         return err;
     }
@@ -479,8 +476,7 @@ Error* parseArg(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *curId
         case TOKEN_NULL: parseTerminal(self, tokens, tokensLen, curIdx, TOKEN_NULL); break;
         default:
             // error
-            err = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-            snprintf(err->message, MAX_ERRMSG_LEN, "Invalid function parameter definition, should be \"arg\" or \"arg = value\", where value is a string, number or null.");
+            err = getParseError(ERR_SYNTAX, MSG_PARAM_DEFINITION, tokens, tokensLen, curIdx);
             astnode_free(self);
             return err;
             break;
@@ -558,8 +554,7 @@ Error* parseFnExpr(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     // Parse function(
     if (lookahead->type != TOKEN_FUNCTION || lookahead2->type != TOKEN_PAREN_L) {
         printf("%s, %s\n", TokenTypeString[lookahead->type], TokenTypeString[lookahead2->type]);
-        Error *fnError = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-        snprintf(fnError->message, MAX_ERRMSG_LEN, "Function definition should start with \"function\" and left parentheses: function(arg1, arg2, ...)");
+        Error *fnError = getParseError(ERR_SYNTAX, MSG_FN_START, tokens, tokensLen, curIdx);
         astnode_free(self);
         return fnError;
     }
@@ -575,8 +570,7 @@ Error* parseFnExpr(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     lookahead = getToken(tokens, tokensLen, *curIdx);
     lookahead2 = getToken(tokens, tokensLen, *curIdx + 1);
     if (lookahead->type != TOKEN_PAREN_R || lookahead2->type != TOKEN_NL) {
-        Error *fnError = getParseError(ERR_SYNTAX, tokens, tokensLen, curIdx);
-        snprintf(fnError->message, MAX_ERRMSG_LEN, "Function definition should end with right parentheses and a new line: function(arg1, arg2, ...)");
+        Error *fnError = getParseError(ERR_SYNTAX, MSG_FN_END, tokens, tokensLen, curIdx);
         astnode_free(self);
         return fnError;
     }
@@ -588,8 +582,7 @@ Error* parseFnExpr(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     lookahead = getToken(tokens, tokensLen, *curIdx);
     while (lookahead->type != TOKEN_END) {
         if (lookahead->type == TOKEN_EOF) {
-            Error *eofError = getParseError(ERR_SYNTAX_EOF, tokens, tokensLen, curIdx);
-            snprintf(eofError->message, MAX_ERRMSG_LEN, "Function block not terminated with \"end function\".");
+            Error *eofError = getParseError(ERR_SYNTAX_EOF, MSG_FN_BLOCK_END, tokens, tokensLen, curIdx);
             astnode_free(self);
             astnode_free(block);
             return eofError;
@@ -605,8 +598,7 @@ Error* parseFnExpr(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     lookahead = getToken(tokens, tokensLen, *curIdx);
     lookahead2 = getToken(tokens, tokensLen, *curIdx + 1);
     if (lookahead->type != TOKEN_END || lookahead2->type != TOKEN_FUNCTION) {
-        Error *eofError = getParseError(ERR_SYNTAX_EOF, tokens, tokensLen, curIdx);
-        snprintf(eofError->message, MAX_ERRMSG_LEN, "Function block not terminated with \"end function\"");
+        Error *eofError = getParseError(ERR_SYNTAX_EOF, MSG_FN_BLOCK_EOF, tokens, tokensLen, curIdx);
         astnode_free(self);
         astnode_free(block);
     }
@@ -697,8 +689,7 @@ Error *parseElseStmt(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *
     while (lookahead->type != TOKEN_END) {
         // Still line in the block
         if (lookahead->type == TOKEN_EOF) {
-            Error *eofError = getParseError(ERR_SYNTAX_EOF, tokens, tokensLen, curIdx);
-            snprintf(eofError->message, MAX_ERRMSG_LEN, "Else block not terminated with \"end if\"."); //TODO: might confuse with nested if
+            Error *eofError = getParseError(ERR_SYNTAX_EOF, MSG_ELSE_BLOCK_END, tokens, tokensLen, curIdx); //TODO: might confuse with nested if
             astnode_free(self);
             astnode_free(block);
             return eofError;
@@ -735,8 +726,7 @@ Error *parseElseIfStmt(ASTNode *parent, Token **tokens, size_t tokensLen, size_t
     while (lookahead->type != TOKEN_END && lookahead->type != TOKEN_ELSE) {
         // Still line in the block
         if (lookahead->type == TOKEN_EOF) {
-            Error *eofError = getParseError(ERR_SYNTAX_EOF, tokens, tokensLen, curIdx);
-            snprintf(eofError->message, MAX_ERRMSG_LEN, "Else If block not terminated with \"end if\" or \"else\"."); //TODO: might confuse with nested if
+            Error *eofError = getParseError(ERR_SYNTAX_EOF, MSG_ELSEIF_BLOCK_END, tokens, tokensLen, curIdx); //TODO: might confuse with nested if
             astnode_free(self);
             astnode_free(block);
             return eofError;
@@ -788,8 +778,7 @@ Error *parseIfStmt(ASTNode *parent, Token **tokens, size_t tokensLen, size_t *cu
     while (lookahead->type != TOKEN_END && lookahead->type != TOKEN_ELSE) {
         // Still line in the block
         if (lookahead->type == TOKEN_EOF) {
-            Error *eofError = getParseError(ERR_SYNTAX_EOF, tokens, tokensLen, curIdx);
-            snprintf(eofError->message, MAX_ERRMSG_LEN, "If block not terminated with \"end if\" or \"else\"."); //TODO: might confuse with nested if
+            Error *eofError = getParseError(ERR_SYNTAX_EOF, MSG_IF_BLOCK_END, tokens, tokensLen, curIdx); //TODO: might confuse with nested if
             astnode_free(self);
             astnode_free(block);
             return eofError;
@@ -849,8 +838,7 @@ Error *parseWhile(ASTNode *parent, Token ** tokens, size_t tokensLen, size_t *cu
     while (lookahead->type != TOKEN_END) {
         // Still line in the block
         if (lookahead->type == TOKEN_EOF) {
-            Error *eofError = getParseError(ERR_SYNTAX_EOF, tokens, tokensLen, curIdx);
-            snprintf(eofError->message, MAX_ERRMSG_LEN, "While loop not terminated with \"end while\"."); //TODO: end while or end? might confuse with nested if
+            Error *eofError = getParseError(ERR_SYNTAX_EOF, MSG_WHILE_BLOCK_END, tokens, tokensLen, curIdx); //TODO: end while or end? might confuse with nested if
             astnode_free(self);
             astnode_free(block);
             return eofError;
@@ -3,24 +3,35 @@
 #include <string.h>
 #include "../logger/logger.h"
 #include "../lexer/token.h"
+#include "../memory/allocator.h"
 #include "symbol.h"
 
 ASTNode *astnode_new(SymbolType type, Token *tok)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
+    ASTNode *node = mem_alloc(sizeof(ASTNode));
     node->type = type;
+    node->quick = QUICK_UNSEEN;
+    node->fused = FUSE_NONE;
+    node->eval = NULL;
+    node->lhs = NULL;
+    node->rhs = NULL;
+    node->op = TOKEN_EOF;
+    node->types = 0;
+    node->hoist = NULL;
     node->tok = NULL;
     if (tok != NULL)
         node->tok = token_clone(tok);
     node->parent = NULL;
-    node->children = malloc(sizeof(ASTNode *) * 0);
+    node->children = NULL;
     node->numChildren = 0;
+    node->childCapacity = 0;
     return node;
 }
 
 ASTNode *astnode_clone(ASTNode *node)
 {
     ASTNode *new = astnode_new(node->type, node->tok);
+    new->fused = node->fused;
 
     // Loop through children and copy
     for (size_t i = 0; i < node->numChildren; i++)
@@ -29,6 +40,14 @@ ASTNode *astnode_clone(ASTNode *node)
     return new;
 }
 
+size_t astnode_count(ASTNode *node)
+{
+    size_t count = 1;
+    for (size_t i = 0; i < node->numChildren; i++)
+        count += astnode_count(node->children[i]);
+    return count;
+}
+
 void astnode_free(ASTNode *node)
 {
     // Loop through children and free
@@ -37,11 +56,35 @@ void astnode_free(ASTNode *node)
         astnode_free(child);
     }
 
-    // Free self
+    // Free self. Hoisted values only live during their loop, so they're already freed.
+    if (node->hoist != NULL) {
+        mem_free(node->hoist->members);
+        mem_free(node->hoist);
+    }
     if (node->tok != NULL)
         token_free(node->tok);
-    free(node->children);
-    free(node);
+    mem_free(node->children);
+    mem_free(node);
+}
+
+Token *astnode_locator(ASTNode *node)
+{
+    while (node != NULL) {
+        switch (node->type) {
+        case SYM_TERMINAL:
+            return node->tok;
+        case SYM_LOG_UNARY: case SYM_UNARY:
+            node = node->children[node->numChildren - 1];
+            break;
+        case SYM_PRIMARY:
+            node = node->children[node->numChildren == 3 ? 1 : 0];
+            break;
+        default:
+            node = node->numChildren > 0 ? node->children[0] : NULL;
+            break;
+        }
+    }
+    return NULL;
 }
 
 void astnode_print(ASTNode *node)
@@ -88,19 +131,36 @@ int astnode_isExpanded(ASTNode *node)
     return 1;
 }
 
+// Makes room for one more child, doubling the capacity of the children when they're full.
+void _astnode_reserve(ASTNode *node)
+{
+    if (node->numChildren < node->childCapacity)
+        return;
+    node->childCapacity = node->childCapacity == 0 ? 4 : node->childCapacity * 2;
+    node->children = mem_realloc(node->children, sizeof(ASTNode *) * node->childCapacity);
+}
+
+// Takes the children off `node`, which is left without any. The array must be freed by the caller.
+ASTNode **_astnode_takeChildren(ASTNode *node)
+{
+    ASTNode **children = node->children;
+    node->children = NULL;
+    node->numChildren = 0;
+    node->childCapacity = 0;
+    return children;
+}
+
 void astnode_addChildNode(ASTNode *parent, ASTNode *child)
 {
-    parent->numChildren++;
-    parent->children = realloc(parent->children, sizeof(ASTNode *) * parent->numChildren);
-    parent->children[parent->numChildren - 1] = child;
+    _astnode_reserve(parent);
+    parent->children[parent->numChildren++] = child;
     child->parent = parent;
 }
 
 void astnode_addChild(ASTNode *node, const SymbolType type, Token *tok)
 {
-    node->numChildren++;
-    node->children = realloc(node->children, sizeof(ASTNode *) * node->numChildren);
-    node->children[node->numChildren - 1] = astnode_new(type, tok);
+    _astnode_reserve(node);
+    node->children[node->numChildren++] = astnode_new(type, tok);
 }
 
 void astnode_addChildExp(ASTNode *node, const SymbolType expectedType) { astnode_addChild(node, expectedType, NULL); }
@@ -109,11 +169,7 @@ void astnode_addChildExp(ASTNode *node, const SymbolType expectedType) { astnode
 void _astnode_remove_rec(ASTNode *node)
 {
     size_t numChildren = node->numChildren;
-    ASTNode **children   = malloc(sizeof(ASTNode *) * numChildren);
-    memcpy(children, node->children, sizeof(ASTNode *) * numChildren);
-    
-    node->numChildren = 0;
-    node->children = realloc(node->children, 0);
+    ASTNode **children = _astnode_takeChildren(node);
     for (size_t i = 0; i < numChildren; i++) {
         ASTNode *child = children[i];
         // Expand the child prior to expansion
@@ -140,7 +196,7 @@ void _astnode_remove_rec(ASTNode *node)
             astnode_addChildNode(node, child);
         }
     }
-    
+    mem_free(children);
 }
 
 // Rebalances a given node such that its subtree is left-skewed with respect to others of the same type.
@@ -239,25 +295,21 @@ void _astnode_left_skew(ASTNode *node, SymbolType targetType)
 
         // 1. Remove op, rChild from curNode (invariant: curNode is ..., lChild, op, rChild)
         curNode->numChildren -= 2;
-        curNode->children = realloc(curNode->children, sizeof(ASTNode) * curNode->numChildren);
 
         // 2. Store right child's current children
         size_t rcNumChildren = rightChild->numChildren;
-        ASTNode **rcChildren = malloc(sizeof(ASTNode *) * rcNumChildren);
-        rcChildren = memcpy(rcChildren, rightChild->children, sizeof(ASTNode *) * rcNumChildren);
+        ASTNode **rcChildren = _astnode_takeChildren(rightChild);
 
         // 3. Reorder right child's children such that:
         //    Original: lChildR, opR, rChildR
         //         New: curNode, op, lChildR, opR, rChildR
-        rightChild->numChildren = 0;
-        rightChild->children = realloc(rightChild->children, 0);
         astnode_addChildNode(rightChild, curNode);
         astnode_addChildNode(rightChild, curOp);
         for (size_t i = 0; i < rcNumChildren; i++)
             astnode_addChildNode(rightChild, rcChildren[i]);
 
         // 4. Cleanup
-        free(rcChildren);
+        mem_free(rcChildren);
 
         // 5. Ensure invariant
         curNode = rightChild;
@@ -314,3 +366,219 @@ ASTNode *astnode_gen(ASTNode *node)
 
     return node;
 }
+
+// Returns 1 if the child at `index` is a terminal with the token type `tokType`.
+int _astnode_isToken(ASTNode *node, size_t index, TokenType tokType)
+{
+    return index < node->numChildren &&
+           node->children[index]->type == SYM_TERMINAL &&
+           node->children[index]->tok->type == tokType;
+}
+
+// Returns 1 if `node` is a terminal that evaluates to a value.
+int _astnode_isValue(ASTNode *node)
+{
+    if (node->type != SYM_TERMINAL)
+        return 0;
+    switch (node->tok->type) {
+    case TOKEN_NULL: case TOKEN_TRUE: case TOKEN_FALSE:
+    case TOKEN_NUMBER: case TOKEN_STRING: case TOKEN_IDENTIFIER:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Returns NULL if `node` has 1 child, or 3 with an operator from `ops` in the middle, otherwise the reason it doesn't.
+const char *_astnode_verifyBinary(ASTNode *node, const TokenType *ops, size_t opCount)
+{
+    if (node->numChildren == 1)
+        return NULL;
+    if (node->numChildren != 3)
+        return "Expected 1 or 3 children.";
+    for (size_t i = 0; i < opCount; i++)
+        if (_astnode_isToken(node, 1, ops[i]))
+            return NULL;
+    return "Unexpected operator.";
+}
+
+// Returns NULL if `node` has 1 child, or 2 with an operator from `ops` first, otherwise the reason it doesn't.
+const char *_astnode_verifyUnary(ASTNode *node, const TokenType *ops, size_t opCount)
+{
+    if (node->numChildren == 1)
+        return NULL;
+    if (node->numChildren != 2)
+        return "Expected 1 or 2 children.";
+    for (size_t i = 0; i < opCount; i++)
+        if (_astnode_isToken(node, 0, ops[i]))
+            return NULL;
+    return "Unexpected operator.";
+}
+
+static const TokenType orOps[] = {TOKEN_OR};
+static const TokenType andOps[] = {TOKEN_AND};
+static const TokenType notOps[] = {TOKEN_NOT};
+static const TokenType equalityOps[] = {TOKEN_EQUAL_EQUAL, TOKEN_BANG_EQUAL};
+static const TokenType comparisonOps[] = {TOKEN_GREATER, TOKEN_GREATER_EQUAL, TOKEN_LESS, TOKEN_LESS_EQUAL};
+static const TokenType sumOps[] = {TOKEN_PLUS, TOKEN_MINUS};
+static const TokenType termOps[] = {TOKEN_STAR, TOKEN_SLASH, TOKEN_PERCENT};
+static const TokenType signOps[] = {TOKEN_PLUS, TOKEN_MINUS};
+static const TokenType powerOps[] = {TOKEN_CARET};
+
+// Returns NULL if `node` itself has the shape the executor expects, otherwise the reason it doesn't.
+const char *_astnode_verifyNode(ASTNode *node)
+{
+    switch (node->type) {
+    case SYM_START:
+        for (size_t i = 0; i < node->numChildren; i++)
+            if (node->children[i]->type != SYM_LINE && !_astnode_isToken(node, i, TOKEN_EOF))
+                return "Unexpected symbol.";
+        return NULL;
+    case SYM_LINE:
+        if (node->numChildren != 1)
+            return "Expected line to have 1 child.";
+        if (node->children[0]->type != SYM_ASMT && node->children[0]->type != SYM_STMT)
+            return "Line has invalid children.";
+        return NULL;
+    case SYM_STMT:
+        if (node->numChildren != 1)
+            return "Invalid statement.";
+        switch (node->children[0]->type) {
+        case SYM_EXPR_STMT: case SYM_PRNT_STMT: case SYM_IFSTMT: case SYM_BREAK:
+        case SYM_CONTINUE: case SYM_WHILE: case SYM_RETURN:
+            return NULL;
+        default:
+            return "Invalid statement.";
+        }
+    case SYM_ASMT:
+        if (node->numChildren != 4 || !_astnode_isToken(node, 0, TOKEN_IDENTIFIER) || !_astnode_isToken(node, 1, TOKEN_EQUAL) ||
+            node->children[2]->type != SYM_EXPR || !_astnode_isToken(node, 3, TOKEN_NL))
+            return "Invalid assignment.";
+        return NULL;
+    case SYM_EXPR_STMT:
+        if (node->numChildren != 2 || node->children[0]->type != SYM_EXPR || !_astnode_isToken(node, 1, TOKEN_NL))
+            return "Invalid exprStmt.";
+        return NULL;
+    case SYM_PRNT_STMT:
+        if (node->numChildren == 1 && _astnode_isToken(node, 0, TOKEN_PRINT))
+            return NULL;
+        if (node->numChildren != 3 || !_astnode_isToken(node, 0, TOKEN_PRINT) ||
+            node->children[1]->type != SYM_EXPR || !_astnode_isToken(node, 2, TOKEN_NL))
+            return "Invalid print statement.";
+        return NULL;
+    case SYM_IFSTMT:
+        if (node->numChildren < 6 || node->children[1]->type != SYM_EXPR || node->children[4]->type != SYM_BLOCK)
+            return "Invalid if statement.";
+        return NULL;
+    case SYM_ELSEIF:
+        if ((node->numChildren != 6 && node->numChildren != 7) ||
+            node->children[2]->type != SYM_EXPR || node->children[5]->type != SYM_BLOCK)
+            return "Invalid else if.";
+        if (node->numChildren == 7 && node->children[6]->type != SYM_ELSEIF && node->children[6]->type != SYM_ELSE)
+            return "Invalid branch -- not else if, or else";
+        return NULL;
+    case SYM_ELSE:
+        if (node->numChildren != 3 || node->children[2]->type != SYM_BLOCK)
+            return "Invalid else.";
+        return NULL;
+    case SYM_BLOCK:
+        for (size_t i = 0; i < node->numChildren; i++)
+            if (node->children[i]->type != SYM_LINE)
+                return "Expected only lines.";
+        return NULL;
+    case SYM_WHILE:
+        if (node->numChildren < 4 || node->children[1]->type != SYM_EXPR || node->children[3]->type != SYM_BLOCK)
+            return "Invalid while statement.";
+        return NULL;
+    case SYM_BREAK:
+    case SYM_CONTINUE:
+        return NULL;
+    case SYM_RETURN:
+        if (node->numChildren == 3 && node->children[1]->type == SYM_EXPR)
+            return NULL;
+        if (node->numChildren != 2)
+            return "Expected 2 or 3 children.";
+        return NULL;
+    case SYM_EXPR:
+        if (node->numChildren != 1)
+            return "Expected 1 child.";
+        if (node->children[0]->type != SYM_OR_EXPR && node->children[0]->type != SYM_FN_EXPR)
+            return "Expected an OR_EXPR or FN_EXPR.";
+        return NULL;
+    case SYM_FN_EXPR:
+        if (node->numChildren != 8)
+            return "Expected 8 children.";
+        if (node->children[2]->type != SYM_ARG_LIST || node->children[5]->type != SYM_BLOCK)
+            return "Expected child 2 to be ARG_LIST, child 5 to be BLOCK.";
+        return NULL;
+    case SYM_ARG_LIST:
+        for (size_t i = 0; i < node->numChildren; i++)
+            if (node->children[i]->type != SYM_ARG && !_astnode_isToken(node, i, TOKEN_COMMA))
+                return "Unexpected child in arglist.";
+        return NULL;
+    case SYM_ARG:
+        if (node->numChildren != 1 && node->numChildren != 3)
+            return "Expected 1 or 3 children.";
+        if (!_astnode_isToken(node, 0, TOKEN_IDENTIFIER))
+            return "Expected an identifier.";
+        if (node->numChildren == 3 && (!_astnode_isToken(node, 1, TOKEN_EQUAL) || !_astnode_isValue(node->children[2])))
+            return "Second child of assignment not an equals.";
+        return NULL;
+    case SYM_OR_EXPR:    return _astnode_verifyBinary(node, orOps, 1);
+    case SYM_AND_EXPR:   return _astnode_verifyBinary(node, andOps, 1);
+    case SYM_LOG_UNARY:  return _astnode_verifyUnary(node, notOps, 1);
+    case SYM_EQUALITY:   return _astnode_verifyBinary(node, equalityOps, 2);
+    case SYM_COMPARISON: return _astnode_verifyBinary(node, comparisonOps, 4);
+    case SYM_SUM:        return _astnode_verifyBinary(node, sumOps, 2);
+    case SYM_TERM:       return _astnode_verifyBinary(node, termOps, 3);
+    case SYM_UNARY:      return _astnode_verifyUnary(node, signOps, 2);
+    case SYM_POWER:      return _astnode_verifyBinary(node, powerOps, 1);
+    case SYM_PRIMARY:
+        // Check if primary is ( EXPR ) or TERMINAL or FN_CALL
+        if (node->numChildren == 1) {
+            if (node->children[0]->type != SYM_FN_CALL && !_astnode_isValue(node->children[0]))
+                return "Expected a TERMINAL or FN_CALL.";
+            return NULL;
+        }
+        if (node->numChildren == 3) {
+            if (!_astnode_isToken(node, 0, TOKEN_PAREN_L) || node->children[1]->type != SYM_EXPR ||
+                !_astnode_isToken(node, 2, TOKEN_PAREN_R))
+                return "Expected ( EXPR ), instead given invalid expression with 3 children.";
+            return NULL;
+        }
+        return "Expected 1 or 3 children.";
+    case SYM_FN_CALL:
+        if (node->numChildren != 4)
+            return "Expected 4 children.";
+        if (!_astnode_isToken(node, 0, TOKEN_IDENTIFIER))
+            return "Invalid child 1, expected an identifier.";
+        if (node->children[2]->type != SYM_FN_ARGS)
+            return "Arguments for function call not of type SYM_FN_ARGS";
+        return NULL;
+    case SYM_FN_ARGS:
+        for (size_t i = 0; i < node->numChildren; i++)
+            if (node->children[i]->type != SYM_EXPR && !_astnode_isToken(node, i, TOKEN_COMMA))
+                return "Unexpected child in arglist.";
+        return NULL;
+    case SYM_TERMINAL:
+        if (node->tok == NULL)
+            return "Terminal without a token.";
+        return NULL;
+    default:
+        return "Unexpected symbol type.";
+    }
+}
+
+ASTNode *astnode_verify(ASTNode *node, const char **reason)
+{
+    *reason = _astnode_verifyNode(node);
+    if (*reason != NULL)
+        return node;
+
+    for (size_t i = 0; i < node->numChildren; i++) {
+        ASTNode *invalid = astnode_verify(node->children[i], reason);
+        if (invalid != NULL)
+            return invalid;
+    }
+    return NULL;
+}
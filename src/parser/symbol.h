@@ -132,12 +132,55 @@ static const char* SymbolTypeString[] = {
     "SYM_TERMINAL",
 };
 
+// Specialisation of a binary operator node, decided by the executor from the operands of its first run.
+typedef enum {
+    QUICK_UNSEEN,   // Not run yet
+    QUICK_GENERIC,  // Operands weren't both numbers, so the node uses the generic value_op* functions
+    QUICK_NUM_ADD, QUICK_NUM_SUB, QUICK_NUM_MUL, QUICK_NUM_DIV, QUICK_NUM_MOD, QUICK_NUM_POW,
+    QUICK_NUM_EQ, QUICK_NUM_NEQ, QUICK_NUM_GT, QUICK_NUM_GEQ, QUICK_NUM_LT, QUICK_NUM_LEQ,
+} Quickening;
+
+// Superinstruction that replaces a whole node chain, see executor/fusion.h
+typedef enum {
+    FUSE_NONE,
+    FUSE_LOCAL_ARITH,   // x = x OP y, where y is a variable or number
+    FUSE_COMPARE,       // x < y, where y is a variable or number
+    FUSE_MOD_EQ,        // x % y == z, where each operand is a variable or number
+    FUSE_COUNT,
+} Fusion;
+
+struct _context;
+struct _execvalue;
+struct _astnode;
+
+// A loop-invariant expression, or a while loop that has some, see executor/hoist.h
+typedef struct _hoist {
+    struct _execvalue *(*eval)(struct _context *ctx, struct _astnode *node); // Evaluator of the expression
+    struct _astnode *loop;      // Loop the expression is invariant in
+    size_t activation;          // Run of `loop` that `value` is from. On a loop, its current run.
+    struct _execvalue *value;   // Value of the expression in that run, or NULL
+    struct _astnode **members;  // On a loop, its invariant expressions
+    size_t memberCount;
+    size_t memberCapacity;
+} Hoist;
+
 typedef struct _astnode {
     SymbolType type;
+    Quickening quick;
+    Fusion fused;
     Token *tok;
     size_t numChildren;
+    size_t childCapacity;   // Length of `children`, which grows by doubling
     struct _astnode *parent;
     struct _astnode **children;
+
+    // Set by execLower(), see executor/executor.h
+    struct _execvalue *(*eval)(struct _context *ctx, struct _astnode *node);
+    struct _astnode *lhs;   // Operands, with the nodes that only pass on their single child skipped
+    struct _astnode *rhs;
+    TokenType op;           // Operator of a binary or unary node
+    unsigned int types;     // ValueTypes the node's value can have, as bits, 0 if unknown, see executor/typeinfer.h
+    Hoist *hoist;
 } ASTNode;
 
 ASTNode *astnode_new(SymbolType type, Token *tok);
@@ -145,6 +188,13 @@ ASTNode *astnode_clone(ASTNode *node);
 void astnode_free(ASTNode *node);
 void astnode_print(ASTNode *node);
 
+// Returns the number of nodes in the tree of `node`, itself included.
+size_t astnode_count(ASTNode *node);
+
+// Returns the token errors about the value of `node` point at: the first token of its leftmost operand, skipping
+// parentheses and unary operators. NULL if there's none.
+Token *astnode_locator(ASTNode *node);
+
 // Adds token with type as a child of this node.
 void astnode_addChild(ASTNode *node, const SymbolType type, Token *tok);
 
@@ -158,4 +208,8 @@ void astnode_clearChildren(ASTNode *node);
 // Converts from parse tree to AST (i.e. removes *_R nodes)
 ASTNode* astnode_gen(ASTNode *node);
 
+// Checks that every node from astnode_gen() has the shape the executor expects, so it doesn't have to check at runtime.
+// Returns NULL if the tree is valid, otherwise the first invalid node, with the reason in `*reason`.
+ASTNode* astnode_verify(ASTNode *node, const char **reason);
+
 #endif
@@ -0,0 +1,269 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../logger/logger.h"
+#include "../memory/allocator.h"
+#include "profile.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+// Calls are timed with the time stamp counter, which takes a fraction of the time of clock_gettime() to read. Ticks
+// are converted to microseconds with the rate measured over the whole profile.
+#define PROFILE_TICKS() __rdtsc()
+#else
+#define PROFILE_TICKS() _profile_nanoseconds()
+#endif
+
+// A calling context: a call site, under the context of its caller.
+typedef struct _profileNode {
+    char *name;
+    int line;                       // Line of the call site, 0 for main
+    size_t calls;
+    uint64_t inclusive;             // Ticks in the calls, callees included
+    uint64_t exclusive;             // Ticks in the calls, callees excluded
+    uint64_t start;                 // Start of the running call
+    uint64_t callees;               // Ticks in callees during the running call
+    struct _profileNode *parent;
+    struct _profileNode *children;
+    struct _profileNode *next;      // Next child of the parent
+} ProfileNode;
+
+// Totals of a function, or of a call site. Calls that are under a call with the same key aren't counted again in
+// the inclusive time, so that recursion doesn't count the same time twice.
+typedef struct {
+    const char *name;
+    int line;                       // -1 for the totals of a function
+    size_t calls;
+    uint64_t inclusive;
+    uint64_t exclusive;
+} ProfileEntry;
+
+typedef struct {
+    ProfileEntry *entries;
+    size_t count;
+} ProfileTable;
+
+// A line of the folded output.
+typedef struct {
+    char *stack;
+    uint64_t exclusive;
+} FoldedStack;
+
+Logger profileLogger = {NULL};
+Logger profileReportLogger = {NULL};
+
+ProfileNode profileRoot = {"main"};
+
+// Node of the running call, the root outside of any call.
+ProfileNode *profileCurrent = NULL;
+
+// Start of the profile, in microseconds of the monotonic clock.
+double profileStart = 0;
+
+// Ticks in a microsecond, measured when the profile is written.
+double profileTicksPerUs = 1;
+
+double _profile_clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+uint64_t _profile_nanoseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int profile_open(const char *path)
+{
+    profileLogger.out = fopen(path, "w");
+    if (profileLogger.out == NULL)
+        return 0;
+    profileCurrent = &profileRoot;
+    profileStart = _profile_clock();
+    profileRoot.start = PROFILE_TICKS();
+    return 1;
+}
+
+int profile_enabled()
+{
+    return profileCurrent != NULL;
+}
+
+void profile_enter(const char *name, int line)
+{
+    ProfileNode *node = profileCurrent->children;
+    while (node != NULL && (node->line != line || strcmp(node->name, name) != 0))
+        node = node->next;
+    if (node == NULL) {
+        node = mem_calloc(1, sizeof(ProfileNode));
+        node->name = mem_strdup(name);
+        node->line = line;
+        node->parent = profileCurrent;
+        node->next = profileCurrent->children;
+        profileCurrent->children = node;
+    }
+    node->callees = 0;
+    profileCurrent = node;
+    node->start = PROFILE_TICKS();
+}
+
+void profile_exit()
+{
+    ProfileNode *node = profileCurrent;
+    uint64_t elapsed = PROFILE_TICKS() - node->start;
+    node->calls++;
+    node->inclusive += elapsed;
+    node->exclusive += elapsed - node->callees;
+    profileCurrent = node->parent;
+    profileCurrent->callees += elapsed;
+}
+
+// Returns 1 if a caller of `node` is the same function, or the same call site if `sameLine` is set.
+int _profile_isNested(ProfileNode *node, int sameLine)
+{
+    for (ProfileNode *caller = node->parent; caller != &profileRoot; caller = caller->parent)
+        if (strcmp(caller->name, node->name) == 0 && (!sameLine || caller->line == node->line))
+            return 1;
+    return 0;
+}
+
+void _profile_addEntry(ProfileTable *table, ProfileNode *node, int line, int nested)
+{
+    ProfileEntry *entry = NULL;
+    for (size_t i = 0; i < table->count && entry == NULL; i++)
+        if (table->entries[i].line == line && strcmp(table->entries[i].name, node->name) == 0)
+            entry = &table->entries[i];
+    if (entry == NULL) {
+        table->count++;
+        table->entries = mem_realloc(table->entries, sizeof(ProfileEntry) * table->count);
+        entry = &table->entries[table->count - 1];
+        *entry = (ProfileEntry) {node->name, line, 0, 0, 0};
+    }
+    entry->calls += node->calls;
+    entry->exclusive += node->exclusive;
+    if (!nested)
+        entry->inclusive += node->inclusive;
+}
+
+// Returns a NEW string with the names from the root to `node`, separated by ';'.
+char *_profile_stack(ProfileNode *node)
+{
+    size_t len = 0;
+    for (ProfileNode *frame = node; frame != NULL; frame = frame->parent)
+        len += strlen(frame->name) + 1;
+    char *stack = mem_alloc(len);
+    stack[len - 1] = '\0';
+    for (ProfileNode *frame = node; frame != NULL; frame = frame->parent) {
+        size_t nameLen = strlen(frame->name);
+        len -= nameLen + 1;
+        memcpy(stack + len, frame->name, nameLen);
+        if (len > 0)
+            stack[len - 1] = ';';
+    }
+    return stack;
+}
+
+// Adds the stacks and entries of `node` and every node under it.
+void _profile_collect(ProfileNode *node, FoldedStack **stacks, size_t *stackCount, ProfileTable *functions,
+                      ProfileTable *sites)
+{
+    (*stackCount)++;
+    *stacks = mem_realloc(*stacks, sizeof(FoldedStack) * (*stackCount));
+    (*stacks)[*stackCount - 1] = (FoldedStack) {_profile_stack(node), node->exclusive};
+    if (node != &profileRoot) {
+        _profile_addEntry(functions, node, -1, _profile_isNested(node, 0));
+        _profile_addEntry(sites, node, node->line, _profile_isNested(node, 1));
+    }
+    for (ProfileNode *child = node->children; child != NULL; child = child->next)
+        _profile_collect(child, stacks, stackCount, functions, sites);
+}
+
+int _profile_compareStacks(const void *a, const void *b)
+{
+    return strcmp(((const FoldedStack *) a)->stack, ((const FoldedStack *) b)->stack);
+}
+
+int _profile_compareEntries(const void *a, const void *b)
+{
+    uint64_t l = ((const ProfileEntry *) a)->exclusive, r = ((const ProfileEntry *) b)->exclusive;
+    return (l < r) - (l > r);
+}
+
+void _profile_reportTable(const char *title, ProfileTable *table)
+{
+    if (table->count > 1)
+        qsort(table->entries, table->count, sizeof(ProfileEntry), _profile_compareEntries);
+    log_message(&profileReportLogger, "%-24s %10s %14s %14s\n", title, "calls", "inclusive ms", "exclusive ms");
+    for (size_t i = 0; i < table->count; i++) {
+        ProfileEntry *entry = &table->entries[i];
+        char label[64];
+        if (entry->line == -1)
+            snprintf(label, sizeof(label), "%s", entry->name);
+        else
+            snprintf(label, sizeof(label), "%s:%d", entry->name, entry->line);
+        log_message(&profileReportLogger, "%-24s %10lu %14.3f %14.3f\n", label, entry->calls,
+                    entry->inclusive / profileTicksPerUs / 1e3, entry->exclusive / profileTicksPerUs / 1e3);
+    }
+}
+
+void _profile_free(ProfileNode *node)
+{
+    ProfileNode *child = node->children;
+    while (child != NULL) {
+        ProfileNode *next = child->next;
+        _profile_free(child);
+        mem_free(child->name);
+        mem_free(child);
+        child = next;
+    }
+}
+
+void profile_close()
+{
+    if (profileCurrent == NULL)
+        return;
+    profileRoot.calls = 1;
+    profileRoot.inclusive = PROFILE_TICKS() - profileRoot.start;
+    profileRoot.exclusive = profileRoot.inclusive - profileRoot.callees;
+    double elapsed = _profile_clock() - profileStart;
+    if (elapsed > 0 && profileRoot.inclusive > 0)
+        profileTicksPerUs = profileRoot.inclusive / elapsed;
+
+    FoldedStack *stacks = NULL;
+    size_t stackCount = 0;
+    ProfileTable functions = {NULL, 0};
+    ProfileTable sites = {NULL, 0};
+    _profile_collect(&profileRoot, &stacks, &stackCount, &functions, &sites);
+
+    // Call sites of the same function are the same frame in a flame graph, so their stacks are merged
+    qsort(stacks, stackCount, sizeof(FoldedStack), _profile_compareStacks);
+    for (size_t i = 0; i < stackCount; i++) {
+        uint64_t exclusive = stacks[i].exclusive;
+        while (i + 1 < stackCount && strcmp(stacks[i].stack, stacks[i + 1].stack) == 0) {
+            mem_free(stacks[i].stack);
+            exclusive += stacks[++i].exclusive;
+        }
+        double us = exclusive / profileTicksPerUs;
+        if (us >= 0.5)
+            log_message(&profileLogger, "%s %.0f\n", stacks[i].stack, us);
+        mem_free(stacks[i].stack);
+    }
+    mem_free(stacks);
+    fclose(profileLogger.out);
+
+    profileReportLogger.out = stderr;
+    log_message(&profileReportLogger, "--- PROFILE ---\n");
+    _profile_reportTable("function", &functions);
+    _profile_reportTable("call site", &sites);
+    mem_free(functions.entries);
+    mem_free(sites.entries);
+
+    _profile_free(&profileRoot);
+    profileRoot = (ProfileNode) {"main"};
+    profileCurrent = NULL;
+}
@@ -0,0 +1,31 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/**
+Script function profiler for --profile. execProfiledFnCall() keeps a shadow stack of the script functions being
+called, as a tree of calling contexts: every call site gets a node under the node of its caller, so a recursive call
+is a node of its own. Every node adds up its calls, and the time spent in them with and without their callees.
+
+At exit, the tree is written as folded stacks, a "main;caller;callee microseconds" line per stack, which flame graph
+tools like flamegraph.pl or speedscope read. The calls and times per function and per call site are reported to
+stderr. Time outside of any script function is main's own.
+
+Function call nodes are only linked to execProfiledFnCall() while profiling, so calls cost nothing more otherwise.
+ */
+
+// Starts a profile written to `path`. Returns 0 if the file can't be opened.
+int profile_open(const char *path);
+
+// Writes the profile, and frees it, if there's one.
+void profile_close();
+
+// Returns 1 while profiling.
+int profile_enabled();
+
+// Pushes a call to the function `name` from the call site on `line`.
+void profile_enter(const char *name, int line);
+
+// Pops the call on top of the stack.
+void profile_exit();
+
+#endif
@@ -0,0 +1,128 @@
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../error/error.h"
+#include "../logger/logger.h"
+#include "../memory/pool.h"
+#include "../executor/execvalue.h"
+#include "../executor/executor.h"
+#include "../executor/memo.h"
+#include "stats.h"
+
+Stats stats = {STATS_OFF};
+
+// Stats go to stderr, apart from the output of the script.
+Logger statsLogger = {NULL};
+
+double _stats_seconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+long _stats_peakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+int stats_enable(const char *format)
+{
+    if (strcmp(format, "text") == 0)
+        stats.format = STATS_TEXT;
+    else if (strcmp(format, "json") == 0)
+        stats.format = STATS_JSON;
+    else
+        return 0;
+    return 1;
+}
+
+StatsMark stats_begin()
+{
+    StatsMark mark = {0};
+    if (stats.format == STATS_OFF)
+        return mark;
+    mark.wall = _stats_seconds(CLOCK_MONOTONIC);
+    mark.cpu = _stats_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    mark.values = valuePool.allocs;
+    mark.calls = fnCalls;
+    return mark;
+}
+
+void stats_end(size_t phase, const char *name, StatsMark mark)
+{
+    if (stats.format == STATS_OFF)
+        return;
+    if (phase >= STATS_MAX_PHASES)
+        criticalError("stats_end: Phase out of range, increase STATS_MAX_PHASES.");
+    PhaseStats *p = &stats.phases[phase];
+    p->name = name;
+    p->runs++;
+    p->wall += _stats_seconds(CLOCK_MONOTONIC) - mark.wall;
+    p->cpu += _stats_seconds(CLOCK_PROCESS_CPUTIME_ID) - mark.cpu;
+    p->values += valuePool.allocs - mark.values;
+    p->calls += fnCalls - mark.calls;
+    p->peakRss = _stats_peakRss();
+}
+
+void _stats_reportText(PhaseStats *total)
+{
+    log_message(&statsLogger, "--- STATS ---\n");
+    log_message(&statsLogger, "%-16s %6s %12s %12s %12s %12s %14s\n", "phase", "runs", "wall ms", "cpu ms", "values",
+                "calls", "peak rss KB");
+    for (size_t i = 0; i < STATS_MAX_PHASES; i++) {
+        PhaseStats *p = &stats.phases[i];
+        if (p->runs == 0)
+            continue;
+        log_message(&statsLogger, "%-16s %6lu %12.3f %12.3f %12lu %12lu %14ld\n", p->name, p->runs, p->wall * 1e3,
+                    p->cpu * 1e3, p->values, p->calls, p->peakRss);
+    }
+    log_message(&statsLogger, "%-16s %6s %12.3f %12.3f %12lu %12lu %14ld\n", "total", "", total->wall * 1e3,
+                total->cpu * 1e3, total->values, total->calls, total->peakRss);
+    log_message(&statsLogger, "%lu tokens, %lu parse tree nodes, %lu AST nodes\n", stats.tokens, stats.parseNodes,
+                stats.astNodes);
+    log_message(&statsLogger, "%lu memo hits, %lu memo misses\n", memoHits, memoMisses);
+}
+
+void _stats_reportJSON(PhaseStats *total)
+{
+    log_message(&statsLogger, "{\"phases\": [");
+    const char *sep = "";
+    for (size_t i = 0; i < STATS_MAX_PHASES; i++) {
+        PhaseStats *p = &stats.phases[i];
+        if (p->runs == 0)
+            continue;
+        log_message(&statsLogger, "%s{\"phase\": \"%s\", \"runs\": %lu, \"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+                    "\"values\": %lu, \"calls\": %lu, \"peak_rss_kb\": %ld}", sep, p->name, p->runs, p->wall * 1e3,
+                    p->cpu * 1e3, p->values, p->calls, p->peakRss);
+        sep = ", ";
+    }
+    log_message(&statsLogger, "], \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"values\": %lu, \"calls\": %lu, "
+                "\"peak_rss_kb\": %ld, \"tokens\": %lu, \"parse_nodes\": %lu, \"ast_nodes\": %lu, \"memo_hits\": %lu, "
+                "\"memo_misses\": %lu}\n", total->wall * 1e3, total->cpu * 1e3, total->values, total->calls,
+                total->peakRss, stats.tokens, stats.parseNodes, stats.astNodes, memoHits, memoMisses);
+}
+
+void stats_report()
+{
+    if (stats.format == STATS_OFF)
+        return;
+    statsLogger.out = stderr;
+
+    PhaseStats total = {"total"};
+    for (size_t i = 0; i < STATS_MAX_PHASES; i++) {
+        PhaseStats *p = &stats.phases[i];
+        total.wall += p->wall;
+        total.cpu += p->cpu;
+        total.values += p->values;
+        total.calls += p->calls;
+    }
+    total.peakRss = _stats_peakRss();
+
+    if (stats.format == STATS_JSON)
+        _stats_reportJSON(&total);
+    else
+        _stats_reportText(&total);
+}
@@ -0,0 +1,61 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+#include <stddef.h>
+
+/**
+Phase timing and counters for --stats. runLine() brackets every state of its FSM with stats_begin() and stats_end(),
+which add the state's wall and CPU time, the values it allocated and the script function calls it made to its phase.
+The front end adds the sizes of what it built. Everything adds up over the runs of a REPL session, and is reported
+once at exit. Nothing is measured while stats are off.
+ */
+
+// Most phases kept apart, phases are indexed by the interpreter's states.
+#define STATS_MAX_PHASES 16
+
+typedef enum {
+    STATS_OFF,
+    STATS_TEXT,
+    STATS_JSON,
+} StatsFormat;
+
+typedef struct {
+    const char *name;
+    size_t runs;          // Times the phase was entered
+    double wall;          // Seconds
+    double cpu;           // Seconds of CPU time of the process
+    size_t values;        // Values allocated
+    size_t calls;         // Script function calls
+    long peakRss;         // Peak resident set size at the end of the phase, in KB
+} PhaseStats;
+
+typedef struct {
+    StatsFormat format;
+    PhaseStats phases[STATS_MAX_PHASES];
+    size_t tokens;
+    size_t parseNodes;    // Nodes of the parse trees
+    size_t astNodes;      // Nodes of the trees from astnode_gen()
+} Stats;
+
+// Readings at the start of a phase.
+typedef struct {
+    double wall;
+    double cpu;
+    size_t values;
+    size_t calls;
+} StatsMark;
+
+extern Stats stats;
+
+// Turns stats on. Returns 0 if `format` isn't text or json.
+int stats_enable(const char *format);
+
+// Takes the readings at the start of a phase.
+StatsMark stats_begin();
+
+// Adds the time and counts since `mark` to the phase `phase`.
+void stats_end(size_t phase, const char *name, StatsMark mark);
+
+// Writes the stats of every phase that was entered to stderr, in the chosen format.
+void stats_report();
+
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <time.h>
+#include "../logger/logger.h"
+#include "trace.h"
+
+Logger traceLogger = {NULL};
+
+// Start of the trace, in microseconds of the monotonic clock.
+double traceOrigin = 0;
+
+// Separator before the next event, none before the first one.
+const char *traceSeparator = "";
+
+double _trace_clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int trace_open(const char *path)
+{
+    traceLogger.out = fopen(path, "w");
+    if (traceLogger.out == NULL)
+        return 0;
+    traceOrigin = _trace_clock();
+    log_message(&traceLogger, "{\"traceEvents\": [");
+    return 1;
+}
+
+void trace_close()
+{
+    if (traceLogger.out == NULL)
+        return;
+    log_message(&traceLogger, "\n], \"displayTimeUnit\": \"ms\"}\n");
+    fclose(traceLogger.out);
+    traceLogger.out = NULL;
+}
+
+int trace_enabled()
+{
+    return traceLogger.out != NULL;
+}
+
+double trace_now()
+{
+    return _trace_clock() - traceOrigin;
+}
+
+// Writes `str` as a JSON string.
+void _trace_string(const char *str)
+{
+    log_message(&traceLogger, "\"");
+    for (const char *c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            log_message(&traceLogger, "\\%c", *c);
+        else if (*c == '\n')
+            log_message(&traceLogger, "\\n");
+        else if ((unsigned char) *c < 0x20)
+            log_message(&traceLogger, "\\u%04x", *c);
+        else
+            log_message(&traceLogger, "%c", *c);
+    }
+    log_message(&traceLogger, "\"");
+}
+
+void trace_span(const char *name, const char *cat, double start, int line)
+{
+    if (traceLogger.out == NULL)
+        return;
+    double end = trace_now();
+    log_message(&traceLogger, "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                "\"pid\": 1, \"tid\": 1", traceSeparator, name, cat, start, end - start);
+    if (line != -1)
+        log_message(&traceLogger, ", \"args\": {\"line\": %d}", line);
+    log_message(&traceLogger, "}");
+    traceSeparator = ",";
+}
+
+void trace_error(Error *err, const char *errStr)
+{
+    if (traceLogger.out == NULL)
+        return;
+    log_message(&traceLogger, "%s\n{\"name\": \"%s\", \"cat\": \"error\", \"ph\": \"i\", \"s\": \"g\", \"ts\": %.3f, "
+                "\"pid\": 1, \"tid\": 1, \"args\": {\"line\": %d, \"column\": %d, \"error\": ", traceSeparator,
+                ErrorTypeString[err->type], trace_now(), err->lineNum + 1, err->colNum + 1);
+    _trace_string(errStr);
+    log_message(&traceLogger, "}}");
+    traceSeparator = ",";
+}
@@ -0,0 +1,32 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+#include "../error/error.h"
+
+/**
+Trace Event Format output for --trace, which trace viewers like Perfetto or chrome://tracing load. The states of the
+runLine() FSM and script function calls are complete events, written when they end, and runtime errors are instant
+events. Timestamps are microseconds since the trace started.
+
+Function call nodes are only linked to execTracedFnCall() while tracing, so calls cost nothing more otherwise.
+ */
+
+// Starts a trace written to `path`. Returns 0 if the file can't be opened.
+int trace_open(const char *path);
+
+// Ends the trace and closes its file, if there's one.
+void trace_close();
+
+// Returns 1 while tracing.
+int trace_enabled();
+
+// Microseconds since the trace started.
+double trace_now();
+
+// Writes an event of category `cat` named `name`, from `start` until now. `line` is added if it's not -1.
+// Names are identifiers or state names, which are written as they are.
+void trace_span(const char *name, const char *cat, double start, int line);
+
+// Writes an instant event for `err`, reported as `errStr`.
+void trace_error(Error *err, const char *errStr);
+
+#endif
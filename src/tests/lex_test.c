@@ -3,6 +3,7 @@
 #include <string.h>
 #define ERR_BUF_SZ 255
 #include "../lexer/lexer.h"
+#include "../memory/allocator.h"
 #include "../lexer/token.h"
 
 void compare_lists(Token** actual, size_t actualSz, Token** expected);
@@ -35,13 +36,13 @@ void freeTokenArr(Token **tokens)
 void resetTokens(Token ***tokenPtr, size_t *tokenSz)
 {
     freeTokenArr(*tokenPtr);
-    *tokenPtr = realloc(*tokenPtr, sizeof(Token *) * 0);
+    *tokenPtr = mem_realloc(*tokenPtr, sizeof(Token *) * 0);
     *tokenSz = 0;
 }
 
 int main()
 {
-    Token **tokens = malloc(sizeof(Token *) * 0);
+    Token **tokens = mem_alloc(sizeof(Token *) * 0);
     size_t tokenSz = 0;
 
     // CASE 1
@@ -97,7 +98,7 @@ int main()
 
     // Cleanup
     resetTokens(&tokens, &tokenSz);
-    free(tokens);
+    mem_free(tokens);
     freeTokenArr(expected1);
     freeTokenArr(expected2);
     freeTokenArr(expected3);
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "runtime.h"
+
+void msrt_init(const char *source)
+{
+    consoleLogger.out = stdout;
+    executionLogger.out = stderr;
+    resultLogger.out = stderr;
+    initErrorContext(source);
+}
+
+void msrt_fail(ExecValue *err)
+{
+    char errStr[MAX_ERRSTR_LEN];
+    error_string(err->value.error_ptr, errStr, MAX_ERRSTR_LEN);
+    log_message(&consoleLogger, "\033[91m%s\033[0m\n", errStr);
+    value_free(err);
+    exit(1);
+}
+
+ExecValue *msrt_load(ExecValue *local, ExecValue *global, Token *tok, const char *name)
+{
+    if (local != NULL)
+        return value_clone(local);
+    if (global != NULL)
+        return value_clone(global);
+
+    Error *nameErr = error_new(ERR_RUNTIME_NAME, MSG_UNDECLARED, -1, -1);
+    return value_locate(value_newError(error_withText(nameErr, name)), tok);
+}
+
+void msrt_store(ExecValue **var, ExecValue *value)
+{
+    if (*var != NULL)
+        value_free(*var);
+    *var = value;
+}
+
+ExecValue *msrt_binary(ExecValue *(*op)(ExecValue *, ExecValue *), ExecValue *lVal, ExecValue *rVal, Token *lTok, Token *rTok)
+{
+    if (lVal->type == TYPE_ERROR) {
+        value_free(rVal);
+        return lVal;
+    } else if (rVal->type == TYPE_ERROR) {
+        value_free(lVal);
+        return rVal;
+    }
+    ExecValue *retVal = op(lVal, rVal);
+    value_free(lVal); value_free(rVal);
+    if (retVal->type == TYPE_ERROR)
+        value_locate(retVal, retVal->rightOperand ? rTok : lTok);
+    return retVal;
+}
+
+ExecValue *msrt_unary(ExecValue *(*op)(ExecValue *), ExecValue *rVal, Token *rTok)
+{
+    if (rVal->type == TYPE_ERROR)
+        return rVal;
+    ExecValue *retVal = op(rVal);
+    value_free(rVal);
+    return value_locate(retVal, rTok);
+}
+
+int msrt_truthy(ExecValue *val)
+{
+    int truthy = value_falsiness(val) == 1;
+    value_free(val);
+    return truthy;
+}
+
+void msrt_print(ExecValue *val)
+{
+    if (val == NULL) {
+        log_message(&consoleLogger, "\n");
+        return;
+    }
+    switch (val->type) {
+    case TYPE_STRING: log_message(&consoleLogger, "%s\n", value_str(val)); break;
+    case TYPE_NUMBER: log_message(&consoleLogger, "%g\n", value_toDouble(val)); break;
+    case TYPE_NULL:   log_message(&consoleLogger, "null\n"); break;
+    default:
+        criticalError("msrt_print: Unexpected type.");
+    }
+    value_free(val);
+}
+
+ExecValue *msrt_noSuchFunction(const char *name, Token *tok)
+{
+    Error *typeErr = error_new(ERR_RUNTIME_TYPE, MSG_NO_SUCH_IDENTIFIER, -1, -1);
+    return value_locate(value_newError(error_withText(typeErr, name)), tok);
+}
+
+void msrt_freeValues(ExecValue **vals, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        value_free(vals[i]);
+}
@@ -0,0 +1,46 @@
+#ifndef _RUNTIME_H_
+#define _RUNTIME_H_
+#include <stdlib.h>
+#include "../logger/logger.h"
+#include "../error/error.h"
+#include "../lexer/token.h"
+#include "../executor/execvalue.h"
+
+/**
+Runtime support for the C files generated by `miniscript --emit-c`, linked from libmsrt.a.
+Values are the interpreter's ExecValues and operators are the value_op* functions, so compiled
+scripts behave like interpreted ones. Unless stated otherwise, functions take ownership of the
+ExecValues passed in.
+ */
+
+// Sets up the loggers and the error context for the embedded script source.
+void msrt_init(const char *source);
+
+// Reports a runtime error the way the interpreter does, and exits.
+void msrt_fail(ExecValue *err);
+
+// Returns a NEW copy of `local`, or of `global` if `local` isn't assigned, or an undeclared identifier error.
+// Neither variable is consumed.
+ExecValue *msrt_load(ExecValue *local, ExecValue *global, Token *tok, const char *name);
+
+// Replaces the value of a variable.
+void msrt_store(ExecValue **var, ExecValue *value);
+
+// Applies an operator after propagating an error from either operand, left first. A type error from the operator
+// points at the token of the operand it's about.
+ExecValue *msrt_binary(ExecValue *(*op)(ExecValue *, ExecValue *), ExecValue *lVal, ExecValue *rVal, Token *lTok, Token *rTok);
+ExecValue *msrt_unary(ExecValue *(*op)(ExecValue *), ExecValue *rVal, Token *rTok);
+
+// Returns 1 if the value is truthy.
+int msrt_truthy(ExecValue *val);
+
+// Prints a value, or an empty line if `val` is NULL.
+void msrt_print(ExecValue *val);
+
+// Returns the error for a call to a function that isn't defined yet.
+ExecValue *msrt_noSuchFunction(const char *name, Token *tok);
+
+// Frees the first `count` values.
+void msrt_freeValues(ExecValue **vals, size_t count);
+
+#endif
@@ -0,0 +1,652 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lexer/token.h"
+#include "../memory/allocator.h"
+#include "../parser/symbol.h"
+#include "../error/error.h"
+#include "transpiler.h"
+
+// A growing string.
+typedef struct {
+    char *data;
+    size_t len;
+} StrBuf;
+
+// A list of identifier names. The names are not owned by the list.
+typedef struct {
+    char **names;
+    size_t count;
+} NameList;
+
+typedef struct {
+    StrBuf *out;            // Buffer that code is currently emitted to
+    int indent;
+    size_t tempCount;       // Used to name temporaries
+    Token **tokens;         // Tokens referenced by the generated code, emitted as the T table
+    size_t tokenCount;
+
+    NameList globals;       // Global variables
+    NameList functions;     // Global functions
+    ASTNode **fnExprs;      // Function expression of each global function
+
+    int inFunction;
+    NameList params;        // Parameters of the current function
+    NameList locals;        // Parameters and variables assigned in the current function
+    size_t *loops;          // Temporary number of the break flag of each enclosing loop
+    size_t loopCount;
+
+    Error ***errorsPtr;
+    size_t *errorCount;
+} Transpiler;
+
+void _strbuf_append(StrBuf *buf, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    buf->data = mem_realloc(buf->data, buf->len + len + 1);
+    va_start(args, fmt);
+    vsnprintf(buf->data + buf->len, len + 1, fmt, args);
+    va_end(args);
+    buf->len += len;
+}
+
+// Appends `str` as a C string literal.
+void _strbuf_appendLiteral(StrBuf *buf, const char *str)
+{
+    _strbuf_append(buf, "\"");
+    for (const char *c = str; *c != '\0'; c++) {
+        switch (*c) {
+        case '"':  _strbuf_append(buf, "\\\""); break;
+        case '\\': _strbuf_append(buf, "\\\\"); break;
+        case '\n': _strbuf_append(buf, "\\n\"\n    \""); break;
+        case '\t': _strbuf_append(buf, "\\t"); break;
+        case '\r': _strbuf_append(buf, "\\r"); break;
+        default:
+            if ((unsigned char) *c < 0x20)
+                _strbuf_append(buf, "\\%03o", (unsigned char) *c);
+            else
+                _strbuf_append(buf, "%c", *c);
+        }
+    }
+    _strbuf_append(buf, "\"");
+}
+
+void _namelist_add(NameList *list, char *name)
+{
+    list->count++;
+    list->names = mem_realloc(list->names, sizeof(char *) * list->count);
+    list->names[list->count - 1] = name;
+}
+
+int _namelist_find(NameList *list, char *name)
+{
+    for (size_t i = 0; i < list->count; i++)
+        if (strcmp(list->names[i], name) == 0)
+            return (int) i;
+    return -1;
+}
+
+// Emits one indented line of code.
+void _tp_line(Transpiler *t, const char *fmt, ...)
+{
+    for (int i = 0; i < t->indent; i++)
+        _strbuf_append(t->out, "    ");
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    char *line = mem_alloc(len + 1);
+    va_start(args, fmt);
+    vsnprintf(line, len + 1, fmt, args);
+    va_end(args);
+
+    _strbuf_append(t->out, "%s\n", line);
+    mem_free(line);
+}
+
+// Returns the first terminal's token under a node, used to locate errors.
+Token *_tp_firstTok(ASTNode *node)
+{
+    if (node->type == SYM_TERMINAL)
+        return node->tok;
+    for (size_t i = 0; i < node->numChildren; i++) {
+        Token *tok = _tp_firstTok(node->children[i]);
+        if (tok != NULL)
+            return tok;
+    }
+    return NULL;
+}
+
+// Records a construct that can't be translated. Always returns 0.
+int _tp_unsupported(Transpiler *t, ASTNode *node, const char *fmt, ...)
+{
+    Token *tok = _tp_firstTok(node);
+    char msg[MAX_ERRMSG_LEN];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, MAX_ERRMSG_LEN, fmt, args);
+    va_end(args);
+    Error *err = error_new(ERR_EMIT, MSG_TEXT, tok ? tok->lineNum : -1, tok ? tok->colNum : -1);
+    error_withText(err, msg);
+
+    *t->errorCount = *t->errorCount + 1;
+    *t->errorsPtr = mem_realloc(*t->errorsPtr, sizeof(Error *) * (*t->errorCount));
+    (*t->errorsPtr)[*t->errorCount - 1] = err;
+    return 0;
+}
+
+// Returns the index of a token in the T table, adding it if it's new.
+size_t _tp_token(Transpiler *t, Token *tok)
+{
+    for (size_t i = 0; i < t->tokenCount; i++)
+        if (t->tokens[i] == tok)
+            return i;
+    t->tokenCount++;
+    t->tokens = mem_realloc(t->tokens, sizeof(Token *) * t->tokenCount);
+    t->tokens[t->tokenCount - 1] = tok;
+    return t->tokenCount - 1;
+}
+
+// Emits the check that stops a statement on an error value.
+void _tp_check(Transpiler *t, size_t temp)
+{
+    if (t->inFunction)
+        _tp_line(t, "if (t%lu->type == TYPE_ERROR) { ret = t%lu; goto done; }", temp, temp);
+    else
+        _tp_line(t, "if (t%lu->type == TYPE_ERROR) msrt_fail(t%lu);", temp, temp);
+}
+
+int _tp_expr(Transpiler *t, ASTNode *node, size_t *temp);
+
+// Emits the load of a variable into a NEW temporary.
+int _tp_identifier(Transpiler *t, ASTNode *terminal, size_t *temp)
+{
+    char *name = terminal->tok->lexeme;
+    size_t tok = _tp_token(t, terminal->tok);
+    *temp = t->tempCount++;
+
+    int isLocal = t->inFunction && _namelist_find(&t->locals, name) >= 0;
+    int isParam = t->inFunction && _namelist_find(&t->params, name) >= 0;
+    int isGlobal = _namelist_find(&t->globals, name) >= 0;
+    if (!isParam && _namelist_find(&t->functions, name) >= 0)
+        return _tp_unsupported(t, terminal, "Function %s can only be called.", name);
+
+    // A local that isn't assigned yet resolves to the global of the same name
+    char local[MAX_ERRMSG_LEN] = "NULL";
+    char global[MAX_ERRMSG_LEN] = "NULL";
+    if (isLocal)
+        snprintf(local, MAX_ERRMSG_LEN, "l_%s", name);
+    if (isGlobal && !isParam)
+        snprintf(global, MAX_ERRMSG_LEN, "g_%s", name);
+    _tp_line(t, "ExecValue *t%lu = msrt_load(%s, %s, &T[%lu], \"%s\");", *temp, local, global, tok, name);
+    return 1;
+}
+
+int _tp_call(Transpiler *t, ASTNode *fnCall, size_t *temp)
+{
+    char *name = fnCall->children[0]->tok->lexeme;
+    size_t tok = _tp_token(t, fnCall->children[0]->tok);
+    if (t->inFunction && _namelist_find(&t->locals, name) >= 0)
+        return _tp_unsupported(t, fnCall, "Only global functions can be called, %s is a local.", name);
+    int fnIdx = _namelist_find(&t->functions, name);
+    if (fnIdx < 0 && _namelist_find(&t->globals, name) >= 0)
+        return _tp_unsupported(t, fnCall, "Global %s is not a function.", name);
+
+    ASTNode *fnArgs = fnCall->children[2];
+    size_t argc = 0;
+    for (size_t i = 0; i < fnArgs->numChildren; i++)
+        if (fnArgs->children[i]->type == SYM_EXPR)
+            argc++;
+
+    *temp = t->tempCount++;
+    _tp_line(t, "ExecValue *t%lu = NULL;", *temp);
+    if (fnIdx < 0) {
+        _tp_line(t, "t%lu = msrt_noSuchFunction(\"%s\", &T[%lu]);", *temp, name, tok);
+        return 1;
+    }
+
+    ASTNode *argList = t->fnExprs[fnIdx]->children[2];
+    size_t paramCount = 0;
+    for (size_t i = 0; i < argList->numChildren; i++)
+        if (argList->children[i]->type == SYM_ARG)
+            paramCount++;
+    if (argc != paramCount)
+        return _tp_unsupported(t, fnCall, "Function %s takes %lu arguments, but is called with %lu.", name, paramCount, argc);
+
+    // The function may be called before the line defining it has run
+    _tp_line(t, "if (!d_%s) {", name);
+    _tp_line(t, "    t%lu = msrt_noSuchFunction(\"%s\", &T[%lu]);", *temp, name, tok);
+    _tp_line(t, "} else {");
+    t->indent++;
+    size_t args = t->tempCount++;
+    _tp_line(t, "ExecValue *t%lu[%lu];", args, argc + 1);
+    _tp_line(t, "do {");
+    t->indent++;
+    size_t argIdx = 0;
+    for (size_t i = 0; i < fnArgs->numChildren; i++) {
+        if (fnArgs->children[i]->type != SYM_EXPR)
+            continue;
+        size_t arg;
+        if (!_tp_expr(t, fnArgs->children[i], &arg))
+            return 0;
+        // An argument that is an error stops the call before the next arguments are evaluated
+        _tp_line(t, "if (t%lu->type == TYPE_ERROR) { msrt_freeValues(t%lu, %lu); t%lu = t%lu; break; }", arg, args, argIdx, *temp, arg);
+        _tp_line(t, "t%lu[%lu] = t%lu;", args, argIdx, arg);
+        argIdx++;
+    }
+    _tp_line(t, "t%lu = fn_%s(t%lu);", *temp, name, args);
+    t->indent--;
+    _tp_line(t, "} while (0);");
+    t->indent--;
+    _tp_line(t, "}");
+    return 1;
+}
+
+const char *_tp_binaryOp(ASTNode *node)
+{
+    if (node->type == SYM_OR_EXPR)
+        return "value_opOr";
+    if (node->type == SYM_AND_EXPR)
+        return "value_opAnd";
+
+    switch (node->children[1]->tok->type) {
+    case TOKEN_PLUS:          return "value_opAdd";
+    case TOKEN_MINUS:         return "value_opSub";
+    case TOKEN_STAR:          return "value_opMul";
+    case TOKEN_SLASH:         return "value_opDiv";
+    case TOKEN_PERCENT:       return "value_opMod";
+    case TOKEN_CARET:         return "value_opPow";
+    case TOKEN_EQUAL_EQUAL:   return "value_opEqEq";
+    case TOKEN_BANG_EQUAL:    return "value_opNEq";
+    case TOKEN_GREATER:       return "value_opGt";
+    case TOKEN_GREATER_EQUAL: return "value_opGEq";
+    case TOKEN_LESS:          return "value_opLt";
+    case TOKEN_LESS_EQUAL:    return "value_opLEq";
+    default:
+        criticalError("transpile: Unexpected binary operator.");
+    }
+    return NULL;
+}
+
+// Emits the code computing an expression into a NEW temporary, whose number is stored in `temp`.
+int _tp_expr(Transpiler *t, ASTNode *node, size_t *temp)
+{
+    switch (node->type) {
+    case SYM_EXPR:
+        if (node->children[0]->type == SYM_FN_EXPR)
+            return _tp_unsupported(t, node, "Function expressions can only be assigned to a global.");
+        return _tp_expr(t, node->children[0], temp);
+    case SYM_OR_EXPR:
+    case SYM_AND_EXPR:
+    case SYM_EQUALITY:
+    case SYM_COMPARISON:
+    case SYM_SUM:
+    case SYM_TERM:
+    case SYM_POWER: {
+        if (node->numChildren == 1)
+            return _tp_expr(t, node->children[0], temp);
+        size_t lVal, rVal;
+        if (!_tp_expr(t, node->children[0], &lVal) || !_tp_expr(t, node->children[2], &rVal))
+            return 0;
+        // Type errors point at one of the operands
+        size_t lTok = _tp_token(t, astnode_locator(node->children[0]));
+        size_t rTok = _tp_token(t, astnode_locator(node->children[2]));
+        *temp = t->tempCount++;
+        _tp_line(t, "ExecValue *t%lu = msrt_binary(%s, t%lu, t%lu, &T[%lu], &T[%lu]);", *temp, _tp_binaryOp(node), lVal, rVal, lTok, rTok);
+        return 1;
+    }
+    case SYM_LOG_UNARY:
+    case SYM_UNARY: {
+        if (node->numChildren == 1)
+            return _tp_expr(t, node->children[0], temp);
+        size_t rVal;
+        if (!_tp_expr(t, node->children[1], &rVal))
+            return 0;
+        const char *op = "value_opUnaryPos";
+        if (node->children[0]->tok->type == TOKEN_MINUS)
+            op = "value_opUnaryNeg";
+        else if (node->children[0]->tok->type == TOKEN_NOT)
+            op = "value_opNot";
+        size_t rTok = _tp_token(t, astnode_locator(node->children[1]));
+        *temp = t->tempCount++;
+        _tp_line(t, "ExecValue *t%lu = msrt_unary(%s, t%lu, &T[%lu]);", *temp, op, rVal, rTok);
+        return 1;
+    }
+    case SYM_PRIMARY:
+        if (node->numChildren == 3)
+            return _tp_expr(t, node->children[1], temp);
+        return _tp_expr(t, node->children[0], temp);
+    case SYM_FN_CALL:
+        return _tp_call(t, node, temp);
+    case SYM_TERMINAL: {
+        Token *tok = node->tok;
+        if (tok->type == TOKEN_IDENTIFIER)
+            return _tp_identifier(t, node, temp);
+
+        *temp = t->tempCount++;
+        switch (tok->type) {
+        case TOKEN_NULL:
+            _tp_line(t, "ExecValue *t%lu = value_newNull();", *temp);
+            return 1;
+        case TOKEN_TRUE:
+            _tp_line(t, "ExecValue *t%lu = value_newNumber(1.0);", *temp);
+            return 1;
+        case TOKEN_FALSE:
+            _tp_line(t, "ExecValue *t%lu = value_newNumber(0.0);", *temp);
+            return 1;
+        case TOKEN_NUMBER:
+            // Literals too large for a double were read as infinity
+            if (isinf(tok->literal.literal_num))
+                _tp_line(t, "ExecValue *t%lu = value_newNumber(HUGE_VAL);", *temp);
+            else
+                _tp_line(t, "ExecValue *t%lu = value_newNumber(%.17g);", *temp, tok->literal.literal_num);
+            return 1;
+        case TOKEN_STRING: {
+            StrBuf literal = {NULL, 0};
+            _strbuf_appendLiteral(&literal, stringref_chars(tok->literal.literal_str));
+            _tp_line(t, "ExecValue *t%lu = value_newString(%s);", *temp, literal.data);
+            mem_free(literal.data);
+            return 1;
+        }
+        default:
+            criticalError("transpile: Invalid token for a terminal.");
+        }
+        return 0;
+    }
+    default:
+        criticalError("transpile: Unexpected expression symbol.");
+    }
+    return 0;
+}
+
+int _tp_block(Transpiler *t, ASTNode *block);
+
+// Emits an if or else if with its condition, block and else branch.
+int _tp_branch(Transpiler *t, ASTNode *cond, ASTNode *block, ASTNode *next)
+{
+    size_t condVal;
+    if (!_tp_expr(t, cond, &condVal))
+        return 0;
+    _tp_check(t, condVal);
+    _tp_line(t, "if (msrt_truthy(t%lu)) {", condVal);
+    t->indent++;
+    int ok = _tp_block(t, block);
+    t->indent--;
+
+    if (next != NULL && next->type == SYM_ELSE) {
+        _tp_line(t, "} else {");
+        t->indent++;
+        ok = ok && _tp_block(t, next->children[2]);
+        t->indent--;
+    } else if (next != NULL && next->type == SYM_ELSEIF) {
+        _tp_line(t, "} else {");
+        t->indent++;
+        ok = ok && _tp_branch(t, next->children[2], next->children[5], next->numChildren == 7 ? next->children[6] : NULL);
+        t->indent--;
+    }
+    _tp_line(t, "}");
+    return ok;
+}
+
+int _tp_while(Transpiler *t, ASTNode *whileStmt)
+{
+    // Like the interpreter, the condition is evaluated once more before a break leaves the loop
+    size_t brk = t->tempCount++;
+    _tp_line(t, "int t%lu = 0;", brk);
+    _tp_line(t, "while (1) {");
+    t->indent++;
+    size_t condVal;
+    if (!_tp_expr(t, whileStmt->children[1], &condVal))
+        return 0;
+    _tp_check(t, condVal);
+    _tp_line(t, "if (!msrt_truthy(t%lu) || t%lu)", condVal, brk);
+    _tp_line(t, "    break;");
+
+    t->loopCount++;
+    t->loops = mem_realloc(t->loops, sizeof(size_t) * t->loopCount);
+    t->loops[t->loopCount - 1] = brk;
+    int ok = _tp_block(t, whileStmt->children[3]);
+    t->loopCount--;
+
+    t->indent--;
+    _tp_line(t, "}");
+    return ok;
+}
+
+int _tp_stmt(Transpiler *t, ASTNode *stmt)
+{
+    size_t val;
+    switch (stmt->type) {
+    case SYM_EXPR_STMT:
+        if (!_tp_expr(t, stmt->children[0], &val))
+            return 0;
+        _tp_check(t, val);
+        _tp_line(t, "value_free(t%lu);", val);
+        return 1;
+    case SYM_PRNT_STMT:
+        if (stmt->numChildren == 1) {
+            _tp_line(t, "msrt_print(NULL);");
+            return 1;
+        }
+        if (!_tp_expr(t, stmt->children[1], &val))
+            return 0;
+        _tp_check(t, val);
+        _tp_line(t, "msrt_print(t%lu);", val);
+        return 1;
+    case SYM_IFSTMT:
+        return _tp_branch(t, stmt->children[1], stmt->children[4], stmt->children[5]);
+    case SYM_WHILE:
+        return _tp_while(t, stmt);
+    case SYM_BREAK:
+        if (t->loopCount == 0)
+            return _tp_unsupported(t, stmt, "break outside of a loop.");
+        _tp_line(t, "t%lu = 1;", t->loops[t->loopCount - 1]);
+        _tp_line(t, "continue;");
+        return 1;
+    case SYM_CONTINUE:
+        if (t->loopCount == 0)
+            return _tp_unsupported(t, stmt, "continue outside of a loop.");
+        _tp_line(t, "continue;");
+        return 1;
+    case SYM_RETURN:
+        if (!t->inFunction)
+            return _tp_unsupported(t, stmt, "return outside of a function.");
+        if (t->loopCount > 0)
+            return _tp_unsupported(t, stmt, "return inside a loop.");
+        if (stmt->numChildren == 2) {
+            _tp_line(t, "ret = value_newNull();");
+        } else {
+            if (!_tp_expr(t, stmt->children[1], &val))
+                return 0;
+            _tp_line(t, "ret = t%lu;", val);
+        }
+        _tp_line(t, "goto done;");
+        return 1;
+    default:
+        criticalError("transpile: Unexpected statement symbol.");
+    }
+    return 0;
+}
+
+int _tp_asmt(Transpiler *t, ASTNode *asmt)
+{
+    char *name = asmt->children[0]->tok->lexeme;
+    ASTNode *expr = asmt->children[2];
+    if (expr->children[0]->type == SYM_FN_EXPR) {
+        if (t->inFunction)
+            return _tp_unsupported(t, asmt, "Functions can only be defined at the top level.");
+        _tp_line(t, "d_%s = 1;", name);
+        return 1;
+    }
+
+    size_t val;
+    if (!_tp_expr(t, expr, &val))
+        return 0;
+    _tp_check(t, val);
+    _tp_line(t, "msrt_store(&%s_%s, t%lu);", t->inFunction ? "l" : "g", name, val);
+    return 1;
+}
+
+int _tp_block(Transpiler *t, ASTNode *block)
+{
+    int ok = 1;
+    for (size_t i = 0; i < block->numChildren; i++) {
+        ASTNode *child = block->children[i];
+        if (child->type != SYM_LINE)
+            continue;
+        ASTNode *line = child->children[0];
+        if (line->type == SYM_ASMT)
+            ok = _tp_asmt(t, line) && ok;
+        else
+            ok = _tp_stmt(t, line->children[0]) && ok;
+    }
+    return ok;
+}
+
+// Collects global variables and functions from the assignments outside of functions.
+int _tp_collectGlobals(Transpiler *t, ASTNode *node)
+{
+    if (node->type == SYM_FN_EXPR)
+        return 1;
+    int ok = 1;
+    if (node->type == SYM_ASMT) {
+        char *name = node->children[0]->tok->lexeme;
+        int isFn = node->children[2]->children[0]->type == SYM_FN_EXPR;
+        int fnIdx = _namelist_find(&t->functions, name);
+        int globalIdx = _namelist_find(&t->globals, name);
+
+        if (fnIdx >= 0 || (isFn && globalIdx >= 0)) {
+            ok = _tp_unsupported(t, node, "Function %s is assigned more than once.", name);
+        } else if (isFn) {
+            _namelist_add(&t->functions, name);
+            t->fnExprs = mem_realloc(t->fnExprs, sizeof(ASTNode *) * t->functions.count);
+            t->fnExprs[t->functions.count - 1] = node->children[2]->children[0];
+        } else if (globalIdx < 0) {
+            _namelist_add(&t->globals, name);
+        }
+    }
+    for (size_t i = 0; i < node->numChildren; i++)
+        ok = _tp_collectGlobals(t, node->children[i]) && ok;
+    return ok;
+}
+
+void _tp_collectLocals(Transpiler *t, ASTNode *node)
+{
+    if (node->type == SYM_ASMT && _namelist_find(&t->locals, node->children[0]->tok->lexeme) < 0)
+        _namelist_add(&t->locals, node->children[0]->tok->lexeme);
+    for (size_t i = 0; i < node->numChildren; i++)
+        _tp_collectLocals(t, node->children[i]);
+}
+
+int _tp_function(Transpiler *t, char *name, ASTNode *fnExpr)
+{
+    ASTNode *argList = fnExpr->children[2];
+    ASTNode *block = fnExpr->children[5];
+    t->inFunction = 1;
+    t->params.count = 0;
+    t->locals.count = 0;
+    t->tempCount = 0;
+
+    int ok = 1;
+    for (size_t i = 0; i < argList->numChildren; i++) {
+        ASTNode *arg = argList->children[i];
+        if (arg->type != SYM_ARG)
+            continue;
+        char *param = arg->children[0]->tok->lexeme;
+        if (arg->numChildren != 1)
+            ok = _tp_unsupported(t, arg, "Parameter %s has a default value.", param);
+        else if (_namelist_find(&t->params, param) >= 0)
+            ok = _tp_unsupported(t, arg, "Parameter %s is repeated.", param);
+        _namelist_add(&t->params, param);
+        _namelist_add(&t->locals, param);
+    }
+    _tp_collectLocals(t, block);
+
+    _tp_line(t, "ExecValue *fn_%s(ExecValue **args)", name);
+    _tp_line(t, "{");
+    t->indent++;
+    _tp_line(t, "ExecValue *ret = NULL;");
+    for (size_t i = 0; i < t->locals.count; i++) {
+        if (i < t->params.count)
+            _tp_line(t, "ExecValue *l_%s = args[%lu];", t->locals.names[i], i);
+        else
+            _tp_line(t, "ExecValue *l_%s = NULL;", t->locals.names[i]);
+    }
+    ok = _tp_block(t, block) && ok;
+    _tp_line(t, "ret = value_newNull();");
+    t->indent--;
+    _tp_line(t, "done:");
+    t->indent++;
+    for (size_t i = 0; i < t->locals.count; i++)
+        _tp_line(t, "if (l_%s != NULL) value_free(l_%s);", t->locals.names[i], t->locals.names[i]);
+    _tp_line(t, "return ret;");
+    t->indent--;
+    _tp_line(t, "}");
+    _tp_line(t, "");
+    t->inFunction = 0;
+    return ok;
+}
+
+char *transpile(ASTNode *root, const char *source, Error ***errorsPtr, size_t *errorCount)
+{
+    Transpiler t = {0};
+    t.errorsPtr = errorsPtr;
+    t.errorCount = errorCount;
+    int ok = _tp_collectGlobals(&t, root);
+
+    StrBuf fnCode = {NULL, 0};
+    t.out = &fnCode;
+    for (size_t i = 0; i < t.functions.count; i++)
+        ok = _tp_function(&t, t.functions.names[i], t.fnExprs[i]) && ok;
+
+    StrBuf mainCode = {NULL, 0};
+    t.out = &mainCode;
+    t.tempCount = 0;
+    t.indent = 1;
+    _tp_line(&t, "msrt_init(source);");
+    ok = _tp_block(&t, root) && ok;
+
+    char *result = NULL;
+    if (ok) {
+        StrBuf out = {NULL, 0};
+        _strbuf_append(&out, "// Generated by miniscript --emit-c\n");
+        _strbuf_append(&out, "#include \"transpiler/runtime.h\"\n\n");
+        _strbuf_append(&out, "static const char *source = ");
+        _strbuf_appendLiteral(&out, source);
+        _strbuf_append(&out, ";\n\n");
+
+        // Tokens give runtime errors their line and column
+        _strbuf_append(&out, "static Token T[] = {\n");
+        for (size_t i = 0; i < t.tokenCount; i++)
+            _strbuf_append(&out, "    {%s, \"\", {0}, %d, %d},\n", TokenTypeString[t.tokens[i]->type], t.tokens[i]->lineNum, t.tokens[i]->colNum);
+        _strbuf_append(&out, "    {TOKEN_EOF, \"\", {0}, -1, -1},\n};\n\n");
+
+        for (size_t i = 0; i < t.globals.count; i++)
+            _strbuf_append(&out, "static ExecValue *g_%s = NULL;\n", t.globals.names[i]);
+        for (size_t i = 0; i < t.functions.count; i++) {
+            _strbuf_append(&out, "static int d_%s = 0;\n", t.functions.names[i]);
+            _strbuf_append(&out, "ExecValue *fn_%s(ExecValue **args);\n", t.functions.names[i]);
+        }
+        _strbuf_append(&out, "\n%s", fnCode.data ? fnCode.data : "");
+        _strbuf_append(&out, "int main()\n{\n%s    return 0;\n}\n", mainCode.data);
+        result = out.data;
+    }
+
+    mem_free(fnCode.data);
+    mem_free(mainCode.data);
+    mem_free(t.tokens);
+    mem_free(t.globals.names);
+    mem_free(t.functions.names);
+    mem_free(t.fnExprs);
+    mem_free(t.params.names);
+    mem_free(t.locals.names);
+    mem_free(t.loops);
+    return result;
+}
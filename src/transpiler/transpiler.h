@@ -0,0 +1,23 @@
+#ifndef _TRANSPILER_H_
+#define _TRANSPILER_H_
+#include <stdlib.h>
+#include "../error/error.h"
+#include "../parser/symbol.h"
+
+/**
+Translates a script into a standalone C program, which links against the runtime library
+built by `make runtime`:
+    gcc -O2 -I src script.c src/libmsrt.a -lm
+
+Global variables and function locals become C variables holding ExecValues, and functions
+become C functions. A script can be translated if:
+- Functions are only defined by assigning a function expression to a global, once.
+- Function names are only called, with as many arguments as parameters, and without default values.
+- `return` is not used at the top level or inside a loop, and `break`/`continue` only inside loops.
+ */
+
+// Returns a NEW string with the C source for the AST of `source`, or NULL if it can't be translated.
+// The reasons are added as errors to `*errorsPtr`.
+char *transpile(ASTNode *root, const char *source, Error ***errorsPtr, size_t *errorCount);
+
+#endif